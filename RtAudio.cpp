@@ -64,11 +64,28 @@ const unsigned int RtApi::SAMPLE_RATES[] = {
   #define MUTEX_DESTROY(A)    pthread_mutex_destroy(A)
   #define MUTEX_LOCK(A)       pthread_mutex_lock(A)
   #define MUTEX_UNLOCK(A)     pthread_mutex_unlock(A)
+  #include <sys/mman.h>
+  #include <sched.h>
+  #include <errno.h>
 #else
   #define MUTEX_INITIALIZE(A) abs(*A) // dummy definitions
   #define MUTEX_DESTROY(A)    abs(*A) // dummy definitions
 #endif
 
+#if defined(__LINUX_ALSA__) || defined(__LINUX_OSS__)
+// Bytes of stack a callback thread touches before its first callback
+// when RTAUDIO_LOCK_MEMORY is set.
+#define RTAUDIO_PREFAULT_STACK 65536
+
+static void prefaultStack( void )
+{
+  char stack[RTAUDIO_PREFAULT_STACK];
+  volatile char *page = stack;
+  for ( unsigned int i = 0; i < RTAUDIO_PREFAULT_STACK; i += 1024 )
+    page[i] = 0;
+}
+#endif
+
 // *************************************************** //
 //
 // RtAudio definitions.
@@ -261,6 +278,7 @@ void RtApi :: openStream( RtAudio::StreamParameters *oParams,
 
   clearStreamInfo();
   bool result;
+  if ( options ) options->applied = RtAudio::RealtimeReport();
 
   if ( oChannels > 0 ) {
 
@@ -283,6 +301,7 @@ void RtApi :: openStream( RtAudio::StreamParameters *oParams,
   stream_.callbackInfo.userData = userData;
 
   if ( options ) options->numberOfBuffers = stream_.nBuffers;
+  lockStreamMemory( options );
   stream_.state = STREAM_STOPPED;
 }
 
@@ -5143,6 +5162,8 @@ static const char* getErrorString( int code )
 
 #include <alsa/asoundlib.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/timerfd.h>
 
   // A structure to hold various information related to the ALSA API
   // implementation.
@@ -5152,9 +5173,13 @@ struct AlsaHandle {
   bool xrun[2];
   pthread_cond_t runnable_cv;
   bool runnable;
+  bool poll;            // wait in poll() (RTAUDIO_ALSA_POLL)
+  int timer;            // timerfd for timed wakeups, or -1
+  struct pollfd *fds;   // both directions' descriptors and the timer's
+  int nfds[2];
 
   AlsaHandle()
-    :synchronized(false), runnable(false) { xrun[0] = false; xrun[1] = false; }
+    :synchronized(false), runnable(false), poll(false), timer(-1), fds(0) { xrun[0] = false; xrun[1] = false; nfds[0] = 0; nfds[1] = 0; }
 };
 
 extern "C" void *alsaCallbackHandler( void * ptr );
@@ -5776,9 +5801,45 @@ bool RtApiAlsa :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigne
 
   stream_.bufferSize = *bufferSize;
 
+  // Setup the wakeup timer with the first direction; it runs from now
+  // on and the callback thread ignores it until the stream starts.  More
+  // than a buffer between wakeups would only cause xruns.
+  int timer = -1;
+  bool timed = false;
+  if ( options && options->flags & RTAUDIO_ALSA_POLL && options->wakeupFrames > 0 ) {
+    if ( stream_.apiHandle )
+      timed = ( (AlsaHandle *) stream_.apiHandle )->timer >= 0;
+    else {
+      unsigned int wakeupFrames = options->wakeupFrames;
+      if ( wakeupFrames > *bufferSize ) wakeupFrames = *bufferSize;
+      long long nsec = 1000000000LL * wakeupFrames / sampleRate;
+      struct itimerspec spec;
+      spec.it_interval.tv_sec = nsec / 1000000000LL;
+      spec.it_interval.tv_nsec = nsec % 1000000000LL;
+      spec.it_value = spec.it_interval;
+      timer = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC );
+      if ( timer < 0 || timerfd_settime( timer, 0, &spec, NULL ) < 0 ) {
+        errorStream_ << "RtApiAlsa::probeDeviceOpen: error setting up the wakeup timer (" << strerror( errno ) << "), waking on the device only.";
+        errorText_ = errorStream_.str();
+        error( RtError::WARNING );
+        if ( timer >= 0 ) close( timer );
+        timer = -1;
+      }
+      timed = timer >= 0;
+    }
+  }
+
+#if SND_LIB_VERSION >= 0x010017
+  // A timer-paced stream can do without period interrupts, where the
+  // driver allows it, but only once the timer is actually running.
+  if ( timed )
+    snd_pcm_hw_params_set_period_wakeup( phandle, hw_params, 0 );
+#endif
+
   // Install the hardware configuration
   result = snd_pcm_hw_params( phandle, hw_params );
   if ( result < 0 ) {
+    if ( timer >= 0 ) close( timer );
     snd_pcm_close( phandle );
     errorStream_ << "RtApiAlsa::probeDeviceOpen: error installing hardware configuration on device (" << name << "), " << snd_strerror( result ) << ".";
     errorText_ = errorStream_.str();
@@ -5802,6 +5863,10 @@ bool RtApiAlsa :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigne
   //snd_pcm_sw_params_set_avail_min( phandle, sw_params, *bufferSize );
   //snd_pcm_sw_params_set_xfer_align( phandle, sw_params, 1 );
 
+  // When polling, wake only once a whole buffer can be transferred.
+  if ( options && options->flags & RTAUDIO_ALSA_POLL )
+    snd_pcm_sw_params_set_avail_min( phandle, sw_params, *bufferSize );
+
   // here are two options for a fix
   //snd_pcm_sw_params_set_silence_size( phandle, sw_params, ULONG_MAX );
   snd_pcm_uframes_t val;
@@ -5810,6 +5875,7 @@ bool RtApiAlsa :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigne
 
   result = snd_pcm_sw_params( phandle, sw_params );
   if ( result < 0 ) {
+    if ( timer >= 0 ) close( timer );
     snd_pcm_close( phandle );
     errorStream_ << "RtApiAlsa::probeDeviceOpen: error installing software configuration on device (" << name << "), " << snd_strerror( result ) << ".";
     errorText_ = errorStream_.str();
@@ -5855,6 +5921,22 @@ bool RtApiAlsa :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigne
     apiInfo = (AlsaHandle *) stream_.apiHandle;
   }
   apiInfo->handles[mode] = phandle;
+  if ( timer >= 0 ) {
+    apiInfo->timer = timer;
+    timer = -1;
+  }
+
+  if ( options && options->flags & RTAUDIO_ALSA_POLL ) {
+    // Room for every descriptor of both directions plus the timer.
+    apiInfo->poll = true;
+    apiInfo->nfds[mode] = snd_pcm_poll_descriptors_count( phandle );
+    struct pollfd *fds = (struct pollfd *) realloc( apiInfo->fds, ( apiInfo->nfds[0] + apiInfo->nfds[1] + 1 ) * sizeof(struct pollfd) );
+    if ( fds == NULL ) {
+      errorText_ = "RtApiAlsa::probeDeviceOpen: error allocating poll descriptors.";
+      goto error;
+    }
+    apiInfo->fds = fds;
+  }
 
   // Allocate necessary internal buffers.
   unsigned long bufferBytes;
@@ -5914,36 +5996,13 @@ bool RtApiAlsa :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigne
     // Setup callback thread.
     stream_.callbackInfo.object = (void *) this;
 
-    // Set the thread attributes for joinable and realtime scheduling
-    // priority (optional).  The higher priority will only take affect
-    // if the program is run as root or suid. Note, under Linux
-    // processes with CAP_SYS_NICE privilege, a user can change
-    // scheduling policy and priority (thus need not be root). See
-    // POSIX "capabilities".
-    pthread_attr_t attr;
-    pthread_attr_init( &attr );
-    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
-#ifdef SCHED_RR // Undefined with some OSes (eg: NetBSD 1.6.x with GNU Pthread)
-    if ( options && options->flags & RTAUDIO_SCHEDULE_REALTIME ) {
-      struct sched_param param;
-      int priority = options->priority;
-      int min = sched_get_priority_min( SCHED_RR );
-      int max = sched_get_priority_max( SCHED_RR );
-      if ( priority < min ) priority = min;
-      else if ( priority > max ) priority = max;
-      param.sched_priority = priority;
-      pthread_attr_setschedparam( &attr, &param );
-      pthread_attr_setschedpolicy( &attr, SCHED_RR );
-    }
-    else
-      pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
-#else
-    pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
-#endif
-
+    // Joinable, with realtime scheduling and CPU affinity if asked
+    // for.  Realtime scheduling only takes effect if the program is run
+    // as root or suid, or, under Linux, with CAP_SYS_NICE or an
+    // RLIMIT_RTPRIO allowance; without them the thread runs with normal
+    // scheduling.
     stream_.callbackInfo.isRunning = true;
-    result = pthread_create( &stream_.callbackInfo.thread, &attr, alsaCallbackHandler, &stream_.callbackInfo );
-    pthread_attr_destroy( &attr );
+    result = createCallbackThread( alsaCallbackHandler, options );
     if ( result ) {
       stream_.callbackInfo.isRunning = false;
       errorText_ = "RtApiAlsa::error creating callback thread!";
@@ -5954,10 +6013,13 @@ bool RtApiAlsa :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigne
   return SUCCESS;
 
  error:
+  if ( timer >= 0 ) close( timer );
   if ( apiInfo ) {
     pthread_cond_destroy( &apiInfo->runnable_cv );
     if ( apiInfo->handles[0] ) snd_pcm_close( apiInfo->handles[0] );
     if ( apiInfo->handles[1] ) snd_pcm_close( apiInfo->handles[1] );
+    if ( apiInfo->timer >= 0 ) close( apiInfo->timer );
+    free( apiInfo->fds );
     delete apiInfo;
     stream_.apiHandle = 0;
   }
@@ -6007,6 +6069,8 @@ void RtApiAlsa :: closeStream()
     pthread_cond_destroy( &apiInfo->runnable_cv );
     if ( apiInfo->handles[0] ) snd_pcm_close( apiInfo->handles[0] );
     if ( apiInfo->handles[1] ) snd_pcm_close( apiInfo->handles[1] );
+    if ( apiInfo->timer >= 0 ) close( apiInfo->timer );
+    free( apiInfo->fds );
     delete apiInfo;
     stream_.apiHandle = 0;
   }
@@ -6102,6 +6166,14 @@ void RtApiAlsa :: stopStream()
   if ( stream_.mode == OUTPUT || stream_.mode == DUPLEX ) {
     if ( apiInfo->synchronized ) 
       result = snd_pcm_drop( handle[0] );
+    else if ( apiInfo->timer >= 0 ) {
+      // Without period interrupts nothing wakes snd_pcm_drain(), so
+      // sleep out whatever is still queued and then drop.
+      snd_pcm_sframes_t delay;
+      if ( snd_pcm_delay( handle[0], &delay ) == 0 && delay > 0 )
+        usleep( (useconds_t) ( 1000000LL * delay / stream_.sampleRate ) );
+      result = snd_pcm_drop( handle[0] );
+    }
     else
       result = snd_pcm_drain( handle[0] );
     if ( result < 0 ) {
@@ -6195,6 +6267,8 @@ void RtApiAlsa :: callbackEvent()
     return;
   }
 
+  if ( apiInfo->poll && !waitForBuffer() ) return;
+
   int doStopStream = 0;
   RtAudioCallback callback = (RtAudioCallback) stream_.callbackInfo.callback;
   double streamTime = getStreamTime();
@@ -6360,12 +6434,80 @@ void RtApiAlsa :: callbackEvent()
   if ( doStopStream == 1 ) this->stopStream();
 }
 
+// Waits until a whole buffer can be read and written.  Only the
+// directions not ready yet are polled, so a duplex stream wakes once,
+// when the later of the two is.  Returns false if the stream stopped.
+bool RtApiAlsa :: waitForBuffer()
+{
+  AlsaHandle *apiInfo = (AlsaHandle *) stream_.apiHandle;
+  snd_pcm_t **handle = (snd_pcm_t **) apiInfo->handles;
+  snd_pcm_sframes_t frames = stream_.bufferSize;
+  bool timed = apiInfo->timer >= 0;
+  // Long enough for any wakeup, short enough to notice a stop.
+  int timeout = (int) ( 4000.0 * stream_.bufferSize / stream_.sampleRate ) + 1;
+
+  while ( stream_.state == STREAM_RUNNING ) {
+    struct pollfd *fds = apiInfo->fds;
+    int first[2] = { 0, 0 }, count[2] = { 0, 0 }, nfds = 0;
+    bool ready = true;
+    for ( int i = 0; i < 2; i++ ) {
+      if ( !handle[i] ) continue;
+      // A prepared capture device would only start on a read.
+      if ( i == 1 && snd_pcm_state( handle[1] ) == SND_PCM_STATE_PREPARED )
+        snd_pcm_start( handle[1] );
+      // The timer fires between interrupts, so read the hardware
+      // position then.
+      snd_pcm_sframes_t avail = timed ? snd_pcm_avail( handle[i] ) : snd_pcm_avail_update( handle[i] );
+      // On an xrun, the transfer reports and recovers it.
+      if ( avail < 0 ) return true;
+      if ( avail >= frames ) continue;
+      ready = false;
+      first[i] = nfds;
+      count[i] = snd_pcm_poll_descriptors( handle[i], fds + nfds, apiInfo->nfds[i] );
+      nfds += count[i];
+    }
+    if ( ready ) return true;
+
+    if ( timed ) {
+      fds[nfds].fd = apiInfo->timer;
+      fds[nfds].events = POLLIN;
+      fds[nfds].revents = 0;
+      nfds++;
+    }
+
+    int result = poll( fds, nfds, timeout );
+    if ( result < 0 && errno != EINTR ) {
+      errorStream_ << "RtApiAlsa::waitForBuffer: poll error, " << strerror( errno ) << ".";
+      errorText_ = errorStream_.str();
+      error( RtError::WARNING );
+      return false;
+    }
+    if ( result <= 0 ) continue;
+
+    if ( timed && fds[nfds - 1].revents & POLLIN ) {
+      // Clear the expirations.
+      unsigned long long ticks;
+      if ( read( apiInfo->timer, &ticks, sizeof(ticks) ) < 0 ) ticks = 0;
+    }
+    for ( int i = 0; i < 2; i++ ) {
+      unsigned short revents = 0;
+      if ( count[i] == 0 ) continue;
+      snd_pcm_poll_descriptors_revents( handle[i], fds + first[i], count[i], &revents );
+      if ( revents & POLLERR ) return true;
+    }
+  }
+
+  return false;
+}
+
 extern "C" void *alsaCallbackHandler( void *ptr )
 {
   CallbackInfo *info = (CallbackInfo *) ptr;
   RtApiAlsa *object = (RtApiAlsa *) info->object;
   bool *isRunning = &info->isRunning;
 
+  if ( info->prefault ) prefaultStack();
+
   while ( *isRunning == true ) {
     pthread_testcancel();
     object->callbackEvent();
@@ -6915,33 +7057,11 @@ bool RtApiOss :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigned
     // Setup callback thread.
     stream_.callbackInfo.object = (void *) this;
 
-    // Set the thread attributes for joinable and realtime scheduling
-    // priority.  The higher priority will only take affect if the
-    // program is run as root or suid.
-    pthread_attr_t attr;
-    pthread_attr_init( &attr );
-    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
-#ifdef SCHED_RR // Undefined with some OSes (eg: NetBSD 1.6.x with GNU Pthread)
-    if ( options && options->flags & RTAUDIO_SCHEDULE_REALTIME ) {
-      struct sched_param param;
-      int priority = options->priority;
-      int min = sched_get_priority_min( SCHED_RR );
-      int max = sched_get_priority_max( SCHED_RR );
-      if ( priority < min ) priority = min;
-      else if ( priority > max ) priority = max;
-      param.sched_priority = priority;
-      pthread_attr_setschedparam( &attr, &param );
-      pthread_attr_setschedpolicy( &attr, SCHED_RR );
-    }
-    else
-      pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
-#else
-    pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
-#endif
-
+    // Joinable, with realtime scheduling and CPU affinity if asked
+    // for.  Realtime scheduling only takes effect if the program is run
+    // as root or suid (or with CAP_SYS_NICE under Linux).
     stream_.callbackInfo.isRunning = true;
-    result = pthread_create( &stream_.callbackInfo.thread, &attr, ossCallbackHandler, &stream_.callbackInfo );
-    pthread_attr_destroy( &attr );
+    result = createCallbackThread( ossCallbackHandler, options );
     if ( result ) {
       stream_.callbackInfo.isRunning = false;
       errorText_ = "RtApiOss::error creating callback thread!";
@@ -7301,6 +7421,8 @@ extern "C" void *ossCallbackHandler( void *ptr )
   RtApiOss *object = (RtApiOss *) info->object;
   bool *isRunning = &info->isRunning;
 
+  if ( info->prefault ) prefaultStack();
+
   while ( *isRunning == true ) {
     pthread_testcancel();
     object->callbackEvent();
@@ -7319,6 +7441,125 @@ extern "C" void *ossCallbackHandler( void *ptr )
 //
 // *************************************************** //
 
+void RtApi :: lockStreamMemory( RtAudio::StreamOptions *options )
+{
+  if ( !options || !( options->flags & RTAUDIO_LOCK_MEMORY ) ) return;
+
+#if defined(__LINUX_ALSA__) || defined(__UNIX_JACK__) || defined(__LINUX_OSS__) || defined(__MACOSX_CORE__)
+  if ( mlockall( MCL_CURRENT | MCL_FUTURE ) == 0 )
+    options->applied.memoryLocked = true;
+  else {
+    errorStream_ << "RtApi::lockStreamMemory: mlockall() failed (" << strerror( errno ) << "), prefaulting the buffers only.";
+    errorText_ = errorStream_.str();
+    error( RtError::WARNING );
+  }
+#endif
+
+  // Write to every page of the buffers the callback uses, so none is
+  // first touched inside it.  The device buffer is shared by both
+  // directions and sized for one of those that convert, so at least the
+  // smaller of them fits.
+  unsigned long deviceBytes = 0;
+  for ( int i = 0; i < 2; i++ ) {
+    if ( stream_.userBuffer[i] )
+      memset( stream_.userBuffer[i], 0, stream_.nUserChannels[i] * stream_.bufferSize * formatBytes( stream_.userFormat ) );
+    if ( stream_.doConvertBuffer[i] && stream_.nDeviceChannels[i] ) {
+      unsigned long bytes = stream_.nDeviceChannels[i] * stream_.bufferSize * formatBytes( stream_.deviceFormat[i] );
+      if ( deviceBytes == 0 || bytes < deviceBytes ) deviceBytes = bytes;
+    }
+  }
+  if ( stream_.deviceBuffer )
+    memset( stream_.deviceBuffer, 0, deviceBytes );
+}
+
+#if defined(__LINUX_ALSA__) || defined(__LINUX_OSS__)
+int RtApi :: createCallbackThread( void *(*handler)( void * ), RtAudio::StreamOptions *options )
+{
+  bool realtime = options && ( options->flags & RTAUDIO_SCHEDULE_REALTIME );
+  bool affinity = options && options->cpuAffinity;
+  bool fallback = false;
+  int result;
+
+  stream_.callbackInfo.prefault = options && ( options->flags & RTAUDIO_LOCK_MEMORY );
+
+  // Everything asked for first, then without realtime scheduling, then
+  // without the affinity as well.
+  for ( ;; ) {
+    pthread_attr_t attr;
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
+#ifdef SCHED_RR // Undefined with some OSes (eg: NetBSD 1.6.x with GNU Pthread)
+    if ( realtime ) {
+      struct sched_param param;
+      int policy = options->flags & RTAUDIO_SCHEDULE_FIFO ? SCHED_FIFO : SCHED_RR;
+      int priority = options->priority;
+      int min = sched_get_priority_min( policy );
+      int max = sched_get_priority_max( policy );
+      if ( priority < min ) priority = min;
+      else if ( priority > max ) priority = max;
+      param.sched_priority = priority;
+      // Without PTHREAD_EXPLICIT_SCHED the thread inherits the creating
+      // thread's scheduling and the policy and priority are ignored.
+      pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+      pthread_attr_setschedpolicy( &attr, policy );
+      pthread_attr_setschedparam( &attr, &param );
+    }
+    else
+      pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
+#else
+    pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
+#endif
+#if defined(__linux__)
+    if ( affinity ) {
+      cpu_set_t cpus;
+      CPU_ZERO( &cpus );
+      for ( int i = 0; i < 64 && i < CPU_SETSIZE; i++ )
+        if ( options->cpuAffinity >> i & 1 ) CPU_SET( i, &cpus );
+      pthread_attr_setaffinity_np( &attr, sizeof(cpus), &cpus );
+    }
+#endif
+
+    result = pthread_create( &stream_.callbackInfo.thread, &attr, handler, &stream_.callbackInfo );
+    pthread_attr_destroy( &attr );
+    if ( result == 0 ) break;
+
+    if ( realtime ) {
+      errorStream_ << "RtApi::createCallbackThread: realtime scheduling refused (" << strerror( result ) << "), using normal scheduling.";
+      realtime = false;
+    }
+    else if ( affinity ) {
+      errorStream_ << "RtApi::createCallbackThread: CPU affinity refused (" << strerror( result ) << "), running on any CPU.";
+      affinity = false;
+    }
+    else
+      return result;
+    errorText_ = errorStream_.str();
+    error( RtError::WARNING );
+    fallback = true;
+  }
+
+  // Report what the thread is actually running with.
+  if ( options ) {
+    RtAudio::RealtimeReport &applied = options->applied;
+    struct sched_param param;
+    int policy;
+    if ( pthread_getschedparam( stream_.callbackInfo.thread, &policy, &param ) == 0 ) {
+      applied.policy = policy;
+      applied.priority = param.sched_priority;
+    }
+#if defined(__linux__)
+    cpu_set_t cpus;
+    if ( pthread_getaffinity_np( stream_.callbackInfo.thread, sizeof(cpus), &cpus ) == 0 )
+      for ( int i = 0; i < 64 && i < CPU_SETSIZE; i++ )
+        if ( CPU_ISSET( i, &cpus ) ) applied.cpuAffinity |= 1ULL << i;
+#endif
+    applied.fallback = fallback;
+  }
+
+  return 0;
+}
+#endif
+
 // This method can be modified to control the behavior of error
 // message printing.
 void RtApi :: error( RtError::Type type )
@@ -87,6 +87,8 @@ static const RtAudioFormat RTAUDIO_FLOAT64 = 0x20; // Normalized between plus/mi
     - \e RTAUDIO_MINIMIZE_LATENCY: Attempt to set stream parameters for lowest possible latency.
     - \e RTAUDIO_HOG_DEVICE:       Attempt grab device for exclusive use.
     - \e RTAUDIO_ALSA_USE_DEFAULT: Use the "default" PCM device (ALSA only).
+    - \e RTAUDIO_SCHEDULE_FIFO:    With RTAUDIO_SCHEDULE_REALTIME, use SCHED_FIFO instead of SCHED_RR.
+    - \e RTAUDIO_LOCK_MEMORY:      Lock the process in memory and prefault the stream buffers.
 
     By default, RtAudio streams pass and receive audio data from the
     client in an interleaved format.  By passing the
@@ -114,10 +116,20 @@ static const RtAudioFormat RTAUDIO_FLOAT64 = 0x20; // Normalized between plus/mi
 
     If the RTAUDIO_SCHEDULE_REALTIME flag is set, RtAudio will attempt 
     to select realtime scheduling (round-robin) for the callback thread.
+    Adding RTAUDIO_SCHEDULE_FIFO selects first-in first-out instead.
 
     If the RTAUDIO_ALSA_USE_DEFAULT flag is set, RtAudio will attempt to
     open the "default" PCM device when using the ALSA API. Note that this
     will override any specified input or output device id.
+
+    If the RTAUDIO_LOCK_MEMORY flag is set, RtAudio will attempt to lock
+    all current and future pages of the process in memory (mlockall())
+    and touch the stream buffers and the callback thread's stack before
+    the stream runs, so the callback does not take page faults.
+
+    If the RTAUDIO_ALSA_POLL flag is set, the ALSA callback thread waits
+    in poll() until a whole buffer can be transferred in every direction
+    of the stream, instead of blocking in the read and then the write.
 */
 typedef unsigned int RtAudioStreamFlags;
 static const RtAudioStreamFlags RTAUDIO_NONINTERLEAVED = 0x1;    // Use non-interleaved buffers (default = interleaved).
@@ -125,6 +137,9 @@ static const RtAudioStreamFlags RTAUDIO_MINIMIZE_LATENCY = 0x2;  // Attempt to s
 static const RtAudioStreamFlags RTAUDIO_HOG_DEVICE = 0x4;        // Attempt grab device and prevent use by others.
 static const RtAudioStreamFlags RTAUDIO_SCHEDULE_REALTIME = 0x8; // Try to select realtime scheduling for callback thread.
 static const RtAudioStreamFlags RTAUDIO_ALSA_USE_DEFAULT = 0x10; // Use the "default" PCM device (ALSA only).
+static const RtAudioStreamFlags RTAUDIO_SCHEDULE_FIFO = 0x20;    // With RTAUDIO_SCHEDULE_REALTIME, use SCHED_FIFO instead of SCHED_RR.
+static const RtAudioStreamFlags RTAUDIO_LOCK_MEMORY = 0x40;      // Lock the process in memory and prefault the stream buffers.
+static const RtAudioStreamFlags RTAUDIO_ALSA_POLL = 0x80;        // Wait for the device in poll() (ALSA only).
 
 /*! \typedef typedef unsigned long RtAudioStreamStatus;
     \brief RtAudio stream status (over- or underflow) flags.
@@ -247,6 +262,19 @@ class RtAudio
       : deviceId(0), nChannels(0), firstChannel(0) {}
   };
 
+  //! The structure reporting the callback thread's actual settings.
+  struct RealtimeReport {
+    int policy;                     /*!< SCHED_OTHER, SCHED_RR or SCHED_FIFO, or -1 if the thread is not RtAudio's. */
+    int priority;                   /*!< Its scheduling priority. */
+    unsigned long long cpuAffinity; /*!< CPUs it may run on (0 = unknown). */
+    bool fallback;                  /*!< Realtime scheduling or the affinity was refused and dropped. */
+    bool memoryLocked;              /*!< mlockall() succeeded. */
+
+    // Default constructor.
+    RealtimeReport()
+      : policy(-1), priority(0), cpuAffinity(0), fallback(false), memoryLocked(false) {}
+  };
+
   //! The structure for specifying stream options.
   /*!
     The following flags can be OR'ed together to allow a client to
@@ -257,6 +285,9 @@ class RtAudio
     - \e RTAUDIO_HOG_DEVICE:        Attempt grab device for exclusive use.
     - \e RTAUDIO_SCHEDULE_REALTIME: Attempt to select realtime scheduling for callback thread.
     - \e RTAUDIO_ALSA_USE_DEFAULT:  Use the "default" PCM device (ALSA only).
+    - \e RTAUDIO_SCHEDULE_FIFO:     With RTAUDIO_SCHEDULE_REALTIME, use SCHED_FIFO instead of SCHED_RR.
+    - \e RTAUDIO_LOCK_MEMORY:       Lock the process in memory and prefault the stream buffers.
+    - \e RTAUDIO_ALSA_POLL:         Wait for the device in poll() (ALSA only).
 
     By default, RtAudio streams pass and receive audio data from the
     client in an interleaved format.  By passing the
@@ -283,14 +314,44 @@ class RtAudio
     Note that this is not possible with all supported audio APIs.
 
     If the RTAUDIO_SCHEDULE_REALTIME flag is set, RtAudio will attempt 
-    to select realtime scheduling (round-robin) for the callback thread.
+    to select realtime scheduling (round-robin, or first-in first-out
+    with RTAUDIO_SCHEDULE_FIFO) for the callback thread.
     The \c priority parameter will only be used if the RTAUDIO_SCHEDULE_REALTIME
-    flag is set. It defines the thread's realtime priority.
+    flag is set. It defines the thread's realtime priority.  If the
+    system refuses realtime scheduling (no CAP_SYS_NICE or RLIMIT_RTPRIO
+    allowance), a warning is printed and the thread runs with normal
+    scheduling instead.
+
+    The \c cpuAffinity parameter restricts the callback thread to the
+    CPUs whose bits are set (bit n = CPU n, 0 = no restriction).  Like
+    realtime scheduling, it applies to callback threads RtAudio creates
+    itself (Linux Alsa and OSS); with the other APIs the callback runs on
+    the audio server's or system's thread.
+
+    If the RTAUDIO_LOCK_MEMORY flag is set, RtAudio will attempt to lock
+    all current and future pages of the process in memory and prefault
+    the stream buffers and (for its own callback threads) the callback
+    thread's stack.
+
+    The \c applied member is filled in by the RtAudio::openStream()
+    function with what the callback thread actually got.
 
     If the RTAUDIO_ALSA_USE_DEFAULT flag is set, RtAudio will attempt to
     open the "default" PCM device when using the ALSA API. Note that this
     will override any specified input or output device id.
 
+    If the RTAUDIO_ALSA_POLL flag is set, the Alsa callback thread waits
+    in a single poll() on the descriptors of both directions (avail_min
+    set to the buffer size) and only then transfers, so a duplex stream
+    wakes once per buffer, when both sides are ready.  With \c
+    wakeupFrames non-zero, a timer also wakes the thread every that many
+    frames and the hardware position is read on each wakeup; where the
+    driver allows it, period interrupts are then switched off (only if
+    the timer could be set up) and the timer alone paces the stream.  The
+    callback still runs once per buffer, but starts at most \c
+    wakeupFrames after the buffer is ready.  Stopping such a stream
+    sleeps out the queued output and drops it rather than draining.
+
     The \c numberOfBuffers parameter can be used to control stream
     latency in the Windows DirectSound, Linux OSS, and Linux Alsa APIs
     only.  A value of two is usually the smallest allowed.  Larger
@@ -309,10 +370,13 @@ class RtAudio
     unsigned int numberOfBuffers;  /*!< Number of stream buffers. */
     std::string streamName;        /*!< A stream name (currently used only in Jack). */
     int priority;                  /*!< Scheduling priority of callback thread (only used with flag RTAUDIO_SCHEDULE_REALTIME). */
+    unsigned long long cpuAffinity; /*!< CPUs the callback thread may run on, bit n = CPU n (0 = any). */
+    RealtimeReport applied;        /*!< What the callback thread actually got (set by openStream()). */
+    unsigned int wakeupFrames;     /*!< Timer wakeup interval in frames (only used with flag RTAUDIO_ALSA_POLL, 0 = no timer). */
 
     // Default constructor.
     StreamOptions()
-    : flags(0), numberOfBuffers(0), priority(0) {}
+    : flags(0), numberOfBuffers(0), priority(0), cpuAffinity(0), wakeupFrames(0) {}
   };
 
   //! A static function to determine the available compiled audio APIs.
@@ -536,10 +600,11 @@ struct CallbackInfo {
   void *userData;
   void *apiInfo;   // void pointer for API specific callback information
   bool isRunning;
+  bool prefault;   // touch the thread's stack before the first callback
 
   // Default constructor.
   CallbackInfo()
-    :object(0), callback(0), userData(0), apiInfo(0), isRunning(false) {}
+    :object(0), callback(0), userData(0), apiInfo(0), isRunning(false), prefault(false) {}
 };
 
 // **************************************************************** //
@@ -699,6 +764,22 @@ protected:
   //! Protected common method used to perform byte-swapping on buffers.
   void byteSwapBuffer( char *buffer, unsigned int samples, RtAudioFormat format );
 
+  /*!
+    Protected common method that locks the process in memory and
+    prefaults the stream buffers if RTAUDIO_LOCK_MEMORY is set.
+  */
+  void lockStreamMemory( RtAudio::StreamOptions *options );
+
+#if defined(__LINUX_ALSA__) || defined(__LINUX_OSS__)
+  /*!
+    Protected common method that creates the callback thread with the
+    realtime scheduling and CPU affinity in \c options, dropping
+    whichever the system refuses, and records the result in
+    options->applied.  Returns the pthread_create() result.
+  */
+  int createCallbackThread( void *(*handler)( void * ), RtAudio::StreamOptions *options );
+#endif
+
   //! Protected common method that returns the number of bytes for a given format.
   unsigned int formatBytes( RtAudioFormat format );
 
@@ -903,6 +984,7 @@ public:
 
   std::vector<RtAudio::DeviceInfo> devices_;
   void saveDeviceInfo( void );
+  bool waitForBuffer( void );
   bool probeDeviceOpen( unsigned int device, StreamMode mode, unsigned int channels, 
                         unsigned int firstChannel, unsigned int sampleRate,
                         RtAudioFormat format, unsigned int *bufferSize,
@@ -0,0 +1,907 @@
+//-----------------------------------------------------------------------------
+// name: analysis.cpp
+// desc: multichannel spectrum analysis off the audio thread
+//-----------------------------------------------------------------------------
+#include "analysis.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+
+
+// how long the analysis thread sleeps when no hop is ready, ns
+#define ANALYSIS_IDLE_NS 1000000L
+// and with a sliding dft, which takes every sample as soon as it arrives
+#define ANALYSIS_SDFT_IDLE_NS 100000L
+// samples the sliding dft reads from a ring at a time
+#define ANALYSIS_SDFT_CHUNK 256
+// spins waiting for a hop (pool) or its end (analysis thread) before
+// sleeping
+#define ANALYSIS_SPINS 2000
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: analysis_create()
+// desc: allocate rings, windows, frames and history up front; NULL unless
+//       fftSize is a power of two of at least 4
+//-----------------------------------------------------------------------------
+Analysis * analysis_create( unsigned int channels, unsigned int fftSize, unsigned int hop,
+                            unsigned int sampleRate, unsigned int histSize )
+{
+    FftPlan * plan = fft_plan_create( fftSize / 2, FFT_PRECISION_FLOAT );
+    if( !plan )
+        return NULL;
+
+    Analysis * a = new Analysis;
+    a->channels = channels;
+    a->fftSize = fftSize;
+    a->hop = hop;
+    a->sampleRate = sampleRate;
+    a->bins = fftSize / 2;
+
+    a->window = new float[fftSize];
+    hanning( a->window, fftSize );
+    a->plan = plan;
+    a->cqtPlan = NULL;
+    a->fftScratch = NULL;
+
+    // about a second of input, and never less than a few windows
+    unsigned int capacity = sampleRate > 4 * ( fftSize + hop ) ? sampleRate : 4 * ( fftSize + hop );
+    a->input = new SpscRing<float>[channels];
+    for( unsigned int c = 0; c < channels; c++ )
+        a->input[c].init( capacity );
+    a->dropped.store( 0 );
+
+    for( int i = 0; i < 3; i++ )
+    {
+        AnalysisFrame & f = a->slots[i];
+        f.number = 0;
+        f.time = 0;
+        f.wave = new float[channels * fftSize];
+        f.spectrum = new complex[channels * a->bins];
+        f.descriptors = new Descriptors[channels];
+        f.peak = 0;
+        f.pitch = new PitchEstimate[channels];
+        f.bands = NULL;
+        for( int v = 0; v < ANALYSIS_VIEWS; v++ )
+            f.smoothed[v] = NULL;
+        memset( &f.beat, 0, sizeof(BeatState) );
+        memset( f.wave, 0, sizeof(float) * channels * fftSize );
+        memset( f.spectrum, 0, sizeof(complex) * channels * a->bins );
+        memset( f.descriptors, 0, sizeof(Descriptors) * channels );
+        memset( f.pitch, 0, sizeof(PitchEstimate) * channels );
+    }
+    a->back = 0;
+    a->middle.store( 1 );
+    a->front = 2;
+    a->produced.store( 0 );
+
+    a->histSize = histSize;
+    a->history = new complex[(size_t)histSize * channels * a->bins];
+    a->historyMax = new float[histSize];
+    memset( a->history, 0, sizeof(complex) * histSize * channels * a->bins );
+    memset( a->historyMax, 0, sizeof(float) * histSize );
+    a->histCount.store( 0 );
+    a->histFilled.store( 0 );
+
+    a->bandMap = NULL;
+    a->cqt = NULL;
+    a->bandCount = 0;
+    a->bandHistory = NULL;
+    a->mag = NULL;
+    a->bandOut = NULL;
+    a->cqtFrames = NULL;
+    a->cqtSpectrum = NULL;
+    a->sdft = NULL;
+    a->sdftInput = NULL;
+
+    a->beat = beat_create( (float)sampleRate / hop );
+    a->fluxPrev = new float[channels * a->bins];
+    a->blocks = new float[channels * DESCRIPTORS_BLOCKS( a->bins )];
+    memset( a->fluxPrev, 0, sizeof(float) * channels * a->bins );
+    a->windowPower = 0.0f;
+    for( unsigned int i = 0; i < fftSize; i++ )
+        a->windowPower += a->window[i] * a->window[i];
+    a->windowPower /= fftSize;
+    a->pitch = pitch_create( fftSize, sampleRate, channels );
+    for( int v = 0; v < ANALYSIS_VIEWS; v++ )
+    {
+        a->smooth[v] = NULL;
+        a->smoothHistory[v] = NULL;
+    }
+    a->smoothMag = NULL;
+
+    a->feed = NULL;
+    a->running.store( false );
+    a->workers = 1;
+    a->avoidCpus = 1;
+    a->shard[0] = 0;
+    a->shard[1] = channels;
+    a->posted.store( 0 );
+    a->remaining.store( 0 );
+    pthread_mutex_init( &a->poolLock, NULL );
+    pthread_cond_init( &a->poolWake, NULL );
+    pthread_cond_init( &a->hopDone, NULL );
+
+    a->frames = new float[channels * fftSize];
+    memset( a->frames, 0, sizeof(float) * channels * fftSize );
+    a->batch = new float[channels * fftSize];
+    memset( a->batch, 0, sizeof(float) * channels * fftSize );
+    a->consumed = 0;
+
+    return a;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_destroy()
+// desc: free everything
+//-----------------------------------------------------------------------------
+void analysis_destroy( Analysis * a )
+{
+    if( !a ) return;
+    analysis_stop( a );
+    pthread_mutex_destroy( &a->poolLock );
+    pthread_cond_destroy( &a->poolWake );
+    pthread_cond_destroy( &a->hopDone );
+
+    for( int i = 0; i < 3; i++ )
+    {
+        delete [] a->slots[i].wave;
+        delete [] a->slots[i].spectrum;
+        delete [] a->slots[i].descriptors;
+        delete [] a->slots[i].pitch;
+        delete [] a->slots[i].bands;
+        for( int v = 0; v < ANALYSIS_VIEWS; v++ )
+            delete [] a->slots[i].smoothed[v];
+    }
+    delete [] a->window;
+    fft_plan_destroy( a->plan );
+    fft_plan_destroy( a->cqtPlan );
+    delete [] a->fftScratch;
+    delete [] a->input;
+    delete [] a->history;
+    delete [] a->historyMax;
+    delete [] a->bandHistory;
+    delete [] a->mag;
+    delete [] a->bandOut;
+    delete [] a->cqtFrames;
+    delete [] a->cqtSpectrum;
+    delete [] a->sdftInput;
+    beat_destroy( a->beat );
+    delete [] a->fluxPrev;
+    delete [] a->blocks;
+    pitch_destroy( a->pitch );
+    for( int v = 0; v < ANALYSIS_VIEWS; v++ )
+    {
+        smooth_destroy( a->smooth[v] );
+        delete [] a->smoothHistory[v];
+    }
+    delete [] a->smoothMag;
+    delete [] a->frames;
+    delete [] a->batch;
+    delete a;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_set_feed()
+// desc: attach a shared-memory feed
+//-----------------------------------------------------------------------------
+void analysis_set_feed( Analysis * a, FeedHeader * feed )
+{
+    a->feed = feed;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_alloc_bands()
+// desc: band frames and history for `count` bands per channel
+//-----------------------------------------------------------------------------
+static void analysis_alloc_bands( Analysis * a, unsigned int count )
+{
+    size_t n = (size_t)a->channels * count;
+
+    for( int i = 0; i < 3; i++ )
+    {
+        delete [] a->slots[i].bands;
+        a->slots[i].bands = new complex[n];
+        memset( a->slots[i].bands, 0, sizeof(complex) * n );
+    }
+    delete [] a->bandHistory;
+    a->bandHistory = new complex[a->histSize * n];
+    memset( a->bandHistory, 0, sizeof(complex) * a->histSize * n );
+    a->bandCount = count;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_longest()
+// desc: the longest window transformed, hop or cqt
+//-----------------------------------------------------------------------------
+static unsigned int analysis_longest( const Analysis * a )
+{
+    return a->cqt && a->cqt->fftSize > a->fftSize ? a->cqt->fftSize : a->fftSize;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_set_bands()
+// desc: bands from a band map over this analysis' bins
+//-----------------------------------------------------------------------------
+void analysis_set_bands( Analysis * a, BandMap * map )
+{
+    if( !map || map->bins != a->bins ) return;
+
+    analysis_alloc_bands( a, map->bands );
+    delete [] a->mag;
+    a->mag = new float[(size_t)a->channels * a->bins];
+    delete [] a->bandOut;
+    a->bandOut = new float[(size_t)a->channels * map->bands];
+    a->bandMap = map;
+    a->cqt = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_set_cqt()
+// desc: bands from a cqt, with its own (longer) sliding windows
+//-----------------------------------------------------------------------------
+void analysis_set_cqt( Analysis * a, Cqt * cqt )
+{
+    if( !cqt ) return;
+    size_t n = (size_t)a->channels * cqt->fftSize;
+
+    analysis_alloc_bands( a, cqt->bins );
+    delete [] a->cqtFrames;
+    a->cqtFrames = new float[n];
+    memset( a->cqtFrames, 0, sizeof(float) * n );
+    delete [] a->cqtSpectrum;
+    a->cqtSpectrum = new float[n];
+    a->cqt = cqt;
+    a->bandMap = NULL;
+    analysis_set_precision( a, a->plan->precision );
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_set_precision()
+// desc: plans for the hop and cqt windows, and scratch for the longer
+//-----------------------------------------------------------------------------
+void analysis_set_precision( Analysis * a, FftPrecision precision )
+{
+    fft_plan_destroy( a->plan );
+    a->plan = fft_plan_create( a->bins, precision );
+    fft_plan_destroy( a->cqtPlan );
+    a->cqtPlan = a->cqt ? fft_plan_create( a->cqt->fftSize / 2, precision ) : NULL;
+
+    delete [] a->fftScratch;
+    a->fftScratch = NULL;
+    if( precision == FFT_PRECISION_DOUBLE )
+        a->fftScratch = new double[(size_t)a->channels * analysis_longest( a )];
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_set_smooth()
+// desc: a filter over the view's magnitudes, with its own frames and
+//       history; the rings smooth bands if there are any
+//-----------------------------------------------------------------------------
+void analysis_set_smooth( Analysis * a, AnalysisView view, const SmoothParams * params )
+{
+    if( !params || view < 0 || view >= ANALYSIS_VIEWS ) return;
+    unsigned int count = view == ANALYSIS_VIEW_RINGS && a->bandCount ? a->bandCount : a->bins;
+    size_t n = (size_t)a->channels * count;
+
+    smooth_destroy( a->smooth[view] );
+    a->smooth[view] = smooth_create( count, a->channels, (float)a->sampleRate / a->hop, params );
+    for( int i = 0; i < 3; i++ )
+    {
+        delete [] a->slots[i].smoothed[view];
+        a->slots[i].smoothed[view] = new complex[n];
+        memset( a->slots[i].smoothed[view], 0, sizeof(complex) * n );
+    }
+    delete [] a->smoothHistory[view];
+    a->smoothHistory[view] = new complex[a->histSize * n];
+    memset( a->smoothHistory[view], 0, sizeof(complex) * a->histSize * n );
+
+    delete [] a->smoothMag;
+    a->smoothMag = new float[(size_t)a->channels * ( a->bandCount > a->bins ? a->bandCount : a->bins )];
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_set_sdft()
+// desc: attach a sliding dft over the same window length
+//-----------------------------------------------------------------------------
+void analysis_set_sdft( Analysis * a, Sdft * sdft )
+{
+    if( !sdft || sdft->size != a->fftSize || sdft->channels != a->channels ) return;
+    delete [] a->sdftInput;
+    a->sdftInput = new float[ANALYSIS_SDFT_CHUNK];
+    // it starts where the hop windows are
+    sdft->samples = a->consumed;
+    a->sdft = sdft;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_set_workers()
+// desc: contiguous, evenly sized channel shards
+//-----------------------------------------------------------------------------
+unsigned int analysis_set_workers( Analysis * a, unsigned int n )
+{
+    if( n == 0 )
+    {
+        long cores = sysconf( _SC_NPROCESSORS_ONLN );
+        n = cores > 0 ? (unsigned int)cores : 1;
+    }
+    if( n > a->channels ) n = a->channels;
+    if( n > ANALYSIS_MAX_WORKERS ) n = ANALYSIS_MAX_WORKERS;
+
+    a->workers = n;
+    for( unsigned int w = 0; w <= n; w++ )
+        a->shard[w] = w * a->channels / n;
+    return n;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: analysis_avoid_cpus()
+// desc: cpus the pool leaves to others
+//-----------------------------------------------------------------------------
+void analysis_avoid_cpus( Analysis * a, unsigned long long mask )
+{
+    a->avoidCpus = mask;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: analysis_push()
+// desc: all channels or none, so the rings never drift apart
+//-----------------------------------------------------------------------------
+void analysis_push( Analysis * a, const float * input, unsigned int frames )
+{
+    for( unsigned int c = 0; c < a->channels; c++ )
+    {
+        if( a->input[c].writable() < frames )
+        {
+            a->dropped.store( a->dropped.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+            return;
+        }
+    }
+
+    // the last channel is pushed last: the consumer only checks that one
+    for( unsigned int c = 0; c < a->channels; c++ )
+        a->input[c].push( input + (size_t)c * frames, frames );
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_pending()
+// desc: complete hops waiting in the rings
+//-----------------------------------------------------------------------------
+unsigned int analysis_pending( const Analysis * a )
+{
+    return (unsigned int)( a->input[a->channels - 1].readable() / a->hop );
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_slide()
+// desc: advance every channel's window by one hop
+//-----------------------------------------------------------------------------
+static void analysis_slide( Analysis * a )
+{
+    unsigned int N = a->fftSize;
+    unsigned int hop = a->hop;
+
+    for( unsigned int c = 0; c < a->channels; c++ )
+    {
+        float * w = a->frames + (size_t)c * N;
+        if( hop < N )
+        {
+            memmove( w, w + hop, sizeof(float) * ( N - hop ) );
+            a->input[c].pop( w + N - hop, hop );
+        }
+        else
+        {
+            a->input[c].skip( hop - N );
+            a->input[c].pop( w, N );
+        }
+
+        // the cqt window takes the same new samples (a gap of zeros if
+        // the hop skipped some)
+        if( a->cqt )
+        {
+            unsigned int M = a->cqt->fftSize;
+            unsigned int shift = hop < M ? hop : M;
+            unsigned int take = hop < N ? hop : N;
+            if( take > shift ) take = shift;
+            float * cw = a->cqtFrames + (size_t)c * M;
+            memmove( cw, cw + shift, sizeof(float) * ( M - shift ) );
+            memset( cw + M - shift, 0, sizeof(float) * ( shift - take ) );
+            memcpy( cw + M - take, w + N - take, sizeof(float) * take );
+        }
+    }
+    a->consumed += hop;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_publish_feed()
+// desc: |X| for DC..Nyquist of every channel, then the descriptors, into
+//       the next feed slot
+//-----------------------------------------------------------------------------
+static void analysis_publish_feed( Analysis * a, const AnalysisFrame * f )
+{
+    float * mags = feed_begin( a->feed, f->time );
+    unsigned int half = a->bins;
+
+    for( unsigned int c = 0; c < a->channels; c++ )
+    {
+        const float * fft = (const float *)( f->spectrum + (size_t)c * half );
+        float * m = mags + (size_t)c * ( half + 1 );
+        // rfft() packs the real Nyquist value into the imaginary slot of DC
+        m[0] = fabsf( fft[0] );
+        m[half] = fabsf( fft[1] );
+        for( unsigned int k = 1; k < half; k++ )
+            m[k] = sqrtf( fft[2*k] * fft[2*k] + fft[2*k+1] * fft[2*k+1] );
+    }
+
+    // descriptors after every channel's magnitudes, in struct order
+    static_assert( sizeof(Descriptors) == FEED_DESCRIPTORS * sizeof(float), "feed descriptor layout" );
+    memcpy( mags + (size_t)a->channels * ( half + 1 ), f->descriptors, sizeof(Descriptors) * a->channels );
+
+    feed_end( a->feed );
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_scratch()
+// desc: a channel's double scratch, NULL unless the plans need it
+//-----------------------------------------------------------------------------
+static double * analysis_scratch( const Analysis * a, unsigned int c )
+{
+    return a->fftScratch ? a->fftScratch + (size_t)c * analysis_longest( a ) : NULL;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_shard()
+// desc: window one shard's channels, then one batched rfft for all of them
+//       (the plan channel by channel for a single channel, where batching
+//       only adds the transposes, or at double precision)
+//-----------------------------------------------------------------------------
+static void analysis_shard( Analysis * a, AnalysisFrame * f, unsigned int w )
+{
+    unsigned int N = a->fftSize;
+    unsigned int bins = a->bins;
+    unsigned int c0 = a->shard[w];
+    unsigned int K = a->shard[w + 1] - c0;
+
+    for( unsigned int c = c0; c < c0 + K; c++ )
+    {
+        float * wave = f->wave + (size_t)c * N;
+        memcpy( wave, a->frames + (size_t)c * N, sizeof(float) * N );
+        apply_window( wave, a->window, N );
+    }
+
+    // double would need a shard's worth of double scratch to batch, so it
+    // goes channel by channel
+    if( K == 1 || a->plan->precision == FFT_PRECISION_DOUBLE )
+    {
+        for( unsigned int c = c0; c < c0 + K; c++ )
+        {
+            float * x = (float *)( f->spectrum + (size_t)c * bins );
+            memcpy( x, f->wave + (size_t)c * N, sizeof(float) * N );
+            fft_plan_rfft( a->plan, x, analysis_scratch( a, c ), FFT_FORWARD );
+        }
+    }
+    else
+    {
+        float * x = a->batch + (size_t)c0 * N;
+        const float * in = f->wave + (size_t)c0 * N;
+        float * out = (float *)( f->spectrum + (size_t)c0 * bins );
+        for( unsigned int e = 0; e < N; e++ )
+            for( unsigned int c = 0; c < K; c++ )
+                x[(size_t)e * K + c] = in[(size_t)c * N + e];
+        fft_plan_rfft_batch( a->plan, x, K, FFT_FORWARD );
+        for( unsigned int c = 0; c < K; c++ )
+            for( unsigned int e = 0; e < N; e++ )
+                out[(size_t)c * N + e] = x[(size_t)e * K + c];
+    }
+
+    for( unsigned int c = c0; c < c0 + K; c++ )
+    {
+        const complex * spectrum = f->spectrum + (size_t)c * bins;
+        descriptors_compute( spectrum, bins, (float)a->sampleRate / N, a->windowPower,
+                             a->fluxPrev + (size_t)c * bins,
+                             a->blocks + (size_t)c * DESCRIPTORS_BLOCKS( bins ), &f->descriptors[c] );
+        if( a->pitch )
+            pitch_detect( a->pitch, c, a->frames + (size_t)c * N, a->plan,
+                          analysis_scratch( a, c ), &f->pitch[c] );
+
+        if( a->bandMap )
+        {
+            unsigned int nb = a->bandMap->bands;
+            float * mag = a->mag + (size_t)c * bins;
+            float * out = a->bandOut + (size_t)c * nb;
+            complex * band = f->bands + (size_t)c * nb;
+            // bin 0 is DC, which no band uses
+            mag[0] = fabsf( spectrum[0].re );
+            for( unsigned int k = 1; k < bins; k++ )
+                mag[k] = cmp_abs( spectrum[k] );
+            bands_apply( a->bandMap, mag, out );
+            for( unsigned int b = 0; b < nb; b++ )
+            {
+                band[b].re = out[b];
+                band[b].im = 0.0f;
+            }
+        }
+        else if( a->cqt )
+        {
+            // the atoms carry their own windows
+            unsigned int M = a->cqt->fftSize;
+            float * x = a->cqtSpectrum + (size_t)c * M;
+            memcpy( x, a->cqtFrames + (size_t)c * M, sizeof(float) * M );
+            fft_plan_rfft( a->cqtPlan, x, analysis_scratch( a, c ), FFT_FORWARD );
+            cqt_apply( a->cqt, (const complex *)x, f->bands + (size_t)c * a->bandCount );
+        }
+
+        for( int v = 0; v < ANALYSIS_VIEWS; v++ )
+        {
+            Smooth * s = a->smooth[v];
+            if( !s ) continue;
+            const complex * in = v == ANALYSIS_VIEW_RINGS && a->bandCount
+                                 ? f->bands + (size_t)c * a->bandCount : spectrum;
+            complex * out = f->smoothed[v] + (size_t)c * s->count;
+            float * mag = a->smoothMag + (size_t)c * ( a->bandCount > bins ? a->bandCount : bins );
+            for( unsigned int k = 0; k < s->count; k++ )
+                mag[k] = cmp_abs( in[k] );
+            smooth_apply( s, c, mag );
+            for( unsigned int k = 0; k < s->count; k++ )
+            {
+                out[k].re = mag[k];
+                out[k].im = 0.0f;
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_publish()
+// desc: history, feed, then swap the finished back slot into the middle
+//-----------------------------------------------------------------------------
+static void analysis_publish( Analysis * a )
+{
+    unsigned int bins = a->bins;
+    AnalysisFrame * f = &a->slots[a->back];
+
+    f->peak = 0.0f;
+    for( unsigned int c = 0; c < a->channels; c++ )
+        if( f->descriptors[c].peak > f->peak ) f->peak = f->descriptors[c].peak;
+    f->number = a->produced.load( std::memory_order_relaxed );
+    f->time = (double)a->consumed / a->sampleRate;
+
+    // onsets and beats from every channel's flux
+    float flux = 0.0f;
+    for( unsigned int c = 0; c < a->channels; c++ )
+        flux += f->descriptors[c].flux;
+    beat_update( a->beat, flux );
+    f->beat = a->beat->state;
+
+    // rolling history, modulo histSize
+    unsigned int h = a->histCount.load( std::memory_order_relaxed );
+    memcpy( a->history + (size_t)h * a->channels * bins, f->spectrum,
+            sizeof(complex) * a->channels * bins );
+    a->historyMax[h] = f->peak;
+    if( a->bandCount )
+    {
+        size_t n = (size_t)a->channels * a->bandCount;
+        memcpy( a->bandHistory + h * n, f->bands, sizeof(complex) * n );
+    }
+    for( int v = 0; v < ANALYSIS_VIEWS; v++ )
+        if( a->smooth[v] )
+        {
+            size_t n = (size_t)a->channels * a->smooth[v]->count;
+            memcpy( a->smoothHistory[v] + h * n, f->smoothed[v], sizeof(complex) * n );
+        }
+    a->histCount.store( ( h + 1 ) % a->histSize, std::memory_order_release );
+    if( h + 1 > a->histFilled.load( std::memory_order_relaxed ) )
+        a->histFilled.store( h + 1, std::memory_order_release );
+
+    if( a->feed )
+        analysis_publish_feed( a, f );
+
+    a->back = a->middle.exchange( a->back | ANALYSIS_FRESH, std::memory_order_acq_rel ) & ANALYSIS_SLOT_MASK;
+    a->produced.store( f->number + 1, std::memory_order_release );
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_wake()
+// desc: wake everyone sleeping on a pool condition
+//-----------------------------------------------------------------------------
+static void analysis_wake( Analysis * a, pthread_cond_t * cond )
+{
+    pthread_mutex_lock( &a->poolLock );
+    pthread_cond_broadcast( cond );
+    pthread_mutex_unlock( &a->poolLock );
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_finish()
+// desc: count a shard done; the last one of the hop publishes it
+//-----------------------------------------------------------------------------
+static void analysis_finish( Analysis * a )
+{
+    if( a->remaining.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+    {
+        analysis_publish( a );
+        if( a->workers > 1 )
+            analysis_wake( a, &a->hopDone );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_wait_hop()
+// desc: wait until the hop last posted to the pool is published
+//-----------------------------------------------------------------------------
+static void analysis_wait_hop( Analysis * a )
+{
+    uint64_t posted = a->posted.load( std::memory_order_relaxed );
+    for( int spins = 0; a->produced.load( std::memory_order_acquire ) < posted; spins++ )
+    {
+        if( spins < ANALYSIS_SPINS ) continue;
+        pthread_mutex_lock( &a->poolLock );
+        while( a->produced.load( std::memory_order_acquire ) < posted )
+            pthread_cond_wait( &a->hopDone, &a->poolLock );
+        pthread_mutex_unlock( &a->poolLock );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_hop()
+// desc: slide the windows and analyze them into the back slot, on the pool
+//       if it is running, otherwise shard by shard on this thread
+//-----------------------------------------------------------------------------
+static void analysis_hop( Analysis * a )
+{
+    // the slide overwrites the windows the pool may still be reading,
+    // and the back slot changes when the previous hop is published
+    analysis_wait_hop( a );
+    AnalysisFrame * f = &a->slots[a->back];
+    uint64_t number = a->produced.load( std::memory_order_relaxed );
+
+    analysis_slide( a );
+
+    a->remaining.store( a->workers, std::memory_order_relaxed );
+    if( a->workers > 1 && a->running.load( std::memory_order_relaxed ) )
+    {
+        // the last shard to finish publishes; nobody waits for it here
+        a->posted.store( number + 1, std::memory_order_release );
+        analysis_wake( a, &a->poolWake );
+        analysis_shard( a, f, 0 );
+        analysis_finish( a );
+    }
+    else
+    {
+        for( unsigned int w = 0; w < a->workers; w++ )
+        {
+            analysis_shard( a, f, w );
+            analysis_finish( a );
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_sdft()
+// desc: run the sliding dft over every sample queued since the last call;
+//       it is always ahead of the hop windows, so its samples are still in
+//       the rings `samples - consumed` past their read position
+//-----------------------------------------------------------------------------
+static void analysis_sdft( Analysis * a )
+{
+    Sdft * s = a->sdft;
+    size_t ahead = (size_t)( s->samples - a->consumed );
+    size_t readable = a->input[a->channels - 1].readable();
+    if( readable <= ahead ) return;
+
+    for( size_t left = readable - ahead; left > 0; )
+    {
+        unsigned int n = left < ANALYSIS_SDFT_CHUNK ? (unsigned int)left : ANALYSIS_SDFT_CHUNK;
+        ahead = (size_t)( s->samples - a->consumed );
+        for( unsigned int c = 0; c < a->channels; c++ )
+        {
+            a->input[c].peek( a->sdftInput, n, ahead );
+            sdft_update( s, c, a->sdftInput, n );
+        }
+        sdft_advance( s, n );
+        left -= n;
+    }
+    sdft_publish( s );
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_process()
+// desc: bring the sliding dft up to date, then analyze every hop that is
+//       ready
+//-----------------------------------------------------------------------------
+int analysis_process( Analysis * a )
+{
+    int hops = 0;
+    if( a->sdft )
+        analysis_sdft( a );
+    while( a->input[a->channels - 1].readable() >= a->hop )
+    {
+        analysis_hop( a );
+        hops++;
+    }
+    return hops;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_thread()
+// desc: analyze whenever a hop is ready, nap otherwise
+//-----------------------------------------------------------------------------
+static void * analysis_thread( void * data )
+{
+    Analysis * a = (Analysis *)data;
+    struct timespec idle = { 0, a->sdft ? ANALYSIS_SDFT_IDLE_NS : ANALYSIS_IDLE_NS };
+
+    while( a->running.load( std::memory_order_acquire ) )
+    {
+        if( analysis_process( a ) == 0 )
+            nanosleep( &idle, NULL );
+    }
+
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_pin()
+// desc: keep a thread on one core, round robin over the cores not
+//       avoided (linux only; a hint elsewhere at best)
+//-----------------------------------------------------------------------------
+static void analysis_pin( Analysis * a, pthread_t thread, unsigned int index )
+{
+#ifdef __linux__
+    long cores = sysconf( _SC_NPROCESSORS_ONLN );
+    if( cores > 64 ) cores = 64;
+    int usable[64], count = 0;
+    for( int c = 0; c < cores; c++ )
+        if( !( a->avoidCpus >> c & 1 ) ) usable[count++] = c;
+    // nothing left to share with: don't pin at all
+    if( count == 0 ) return;
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( usable[index % count], &set );
+    pthread_setaffinity_np( thread, sizeof(set), &set );
+#else
+    (void)a;
+    (void)thread;
+    (void)index;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_worker()
+// desc: pool thread: wait for a hop, do this worker's shard
+//-----------------------------------------------------------------------------
+static void * analysis_worker( void * data )
+{
+    AnalysisWorker * worker = (AnalysisWorker *)data;
+    Analysis * a = worker->a;
+    uint64_t done = 0;
+    int spins = 0;
+
+    for( ;; )
+    {
+        uint64_t posted = a->posted.load( std::memory_order_acquire );
+        if( posted == done )
+        {
+            // only leave between hops, the hop needs our shard
+            if( !a->running.load( std::memory_order_relaxed ) ) break;
+            if( ++spins < ANALYSIS_SPINS ) continue;
+            // idle: sleep until the next hop or analysis_stop()
+            pthread_mutex_lock( &a->poolLock );
+            while( a->posted.load( std::memory_order_acquire ) == done &&
+                   a->running.load( std::memory_order_relaxed ) )
+                pthread_cond_wait( &a->poolWake, &a->poolLock );
+            pthread_mutex_unlock( &a->poolLock );
+            spins = 0;
+            continue;
+        }
+        done = posted;
+        spins = 0;
+        analysis_shard( a, &a->slots[a->back], worker->index );
+        analysis_finish( a );
+    }
+
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_start()
+// desc: spawn the analysis thread and the rest of the pool
+//-----------------------------------------------------------------------------
+bool analysis_start( Analysis * a )
+{
+    a->running.store( true );
+    a->posted.store( a->produced.load() );
+    for( unsigned int w = 1; w < a->workers; w++ )
+    {
+        a->pool[w].a = a;
+        a->pool[w].index = w;
+        if( pthread_create( &a->pool[w].thread, NULL, analysis_worker, &a->pool[w] ) )
+        {
+            // run with the threads we got
+            analysis_set_workers( a, w );
+            break;
+        }
+        analysis_pin( a, a->pool[w].thread, w );
+    }
+    if( pthread_create( &a->thread, NULL, analysis_thread, a ) )
+    {
+        a->running.store( false );
+        for( unsigned int w = 1; w < a->workers; w++ )
+            pthread_join( a->pool[w].thread, NULL );
+        return false;
+    }
+    if( a->workers > 1 )
+        analysis_pin( a, a->thread, 0 );
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_stop()
+// desc: join the analysis thread
+//-----------------------------------------------------------------------------
+void analysis_stop( Analysis * a )
+{
+    if( !a->running.load() ) return;
+    a->running.store( false, std::memory_order_release );
+    analysis_wake( a, &a->poolWake );
+    pthread_join( a->thread, NULL );
+    for( unsigned int w = 1; w < a->workers; w++ )
+        pthread_join( a->pool[w].thread, NULL );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: analysis_latest()
+// desc: triple-buffer read side
+//-----------------------------------------------------------------------------
+const AnalysisFrame * analysis_latest( Analysis * a, bool * fresh )
+{
+    bool isFresh = ( a->middle.load( std::memory_order_relaxed ) & ANALYSIS_FRESH ) != 0;
+    if( isFresh )
+        a->front = a->middle.exchange( a->front, std::memory_order_acq_rel ) & ANALYSIS_SLOT_MASK;
+    if( fresh ) *fresh = isFresh;
+    return &a->slots[a->front];
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_history()
+// desc: one channel of a history slot
+//-----------------------------------------------------------------------------
+const complex * analysis_history( const Analysis * a, unsigned int index, unsigned int channel )
+{
+    return a->history + ( (size_t)index * a->channels + channel ) * a->bins;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_band_history()
+// desc: one channel's bands of a history slot
+//-----------------------------------------------------------------------------
+const complex * analysis_band_history( const Analysis * a, unsigned int index, unsigned int channel )
+{
+    if( !a->bandCount ) return NULL;
+    return a->bandHistory + ( (size_t)index * a->channels + channel ) * a->bandCount;
+}
+
+//-----------------------------------------------------------------------------
+// name: analysis_smooth_history()
+// desc: one channel's smoothed magnitudes of a history slot
+//-----------------------------------------------------------------------------
+const complex * analysis_smooth_history( const Analysis * a, AnalysisView view,
+                                         unsigned int index, unsigned int channel )
+{
+    const Smooth * s = a->smooth[view];
+    if( !s ) return NULL;
+    return a->smoothHistory[view] + ( (size_t)index * a->channels + channel ) * s->count;
+}
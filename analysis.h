@@ -0,0 +1,254 @@
+//-----------------------------------------------------------------------------
+// name: analysis.h
+// desc: multichannel spectrum analysis off the audio thread
+//
+//   the callback pushes each channel's samples into its own lock-free
+//   ring; the analysis thread slides an fftSize window along them by
+//   `hop` samples, computes one spectrum per channel and publishes the
+//   result through a triple buffer so the renderer always gets the newest
+//   complete frame without ever blocking either side.
+//
+//   with more than one worker, channels are split into contiguous shards.
+//   the analysis thread slides the windows, posts the hop and works on the
+//   first shard; pool threads (pinned to cores) take the rest.  each shard
+//   decrements the hop's completion counter and whichever finishes last
+//   publishes the frame, so the analysis thread moves on as soon as its
+//   own shard is done.  it only waits for the pool when the next hop is
+//   already due, since sliding overwrites the windows the shards read.
+//   idle pool threads spin briefly, then sleep until a hop is posted.
+//-----------------------------------------------------------------------------
+#ifndef __ANALYSIS_H__
+#define __ANALYSIS_H__
+
+#include "chuck_fft.h"
+#include "ringbuffer.h"
+#include "feed.h"
+#include "bands.h"
+#include "cqt.h"
+#include "sdft.h"
+#include "beat.h"
+#include "descriptors.h"
+#include "pitch.h"
+#include "smooth.h"
+#include "fftplan.h"
+#include <atomic>
+#include <stdint.h>
+#include <pthread.h>
+
+
+// marks the middle slot of the triple buffer as not yet seen by the reader
+#define ANALYSIS_FRESH 4
+#define ANALYSIS_SLOT_MASK 3
+// upper bound on analysis threads
+#define ANALYSIS_MAX_WORKERS 64
+
+
+//-----------------------------------------------------------------------------
+// name: enum AnalysisView
+// desc: visualizations that can have their own smoothing
+//-----------------------------------------------------------------------------
+enum AnalysisView
+{
+    // the rings (bands if there are any, else bins), and the spectrogram
+    ANALYSIS_VIEW_RINGS = 0,
+    ANALYSIS_VIEW_SPECTROGRAM,
+    ANALYSIS_VIEWS
+};
+
+
+//-----------------------------------------------------------------------------
+// name: struct AnalysisFrame
+// desc: one hop's worth of results for every channel
+//-----------------------------------------------------------------------------
+struct AnalysisFrame
+{
+    // hop counter and stream time of the newest sample, seconds
+    uint64_t number;
+    double time;
+    // windowed input, [channels][fftSize]
+    float * wave;
+    // rfft() output, [channels][bins] (bin 0 holds DC and Nyquist)
+    complex * spectrum;
+    // rms, peak, centroid, ... per channel, and the largest |X| over all
+    // channels
+    Descriptors * descriptors;
+    float peak;
+    // f0 and its confidence per channel, from the unwindowed input
+    PitchEstimate * pitch;
+    // bands if a band map or cqt is set, [channels][bandCount]; a band
+    // map's levels have im = 0 so they draw like a spectrum
+    complex * bands;
+    // onsets, tempo and beat phase as of this hop
+    BeatState beat;
+    // smoothed magnitudes per view (im = 0), [channels][count], NULL for
+    // views without smoothing
+    complex * smoothed[ANALYSIS_VIEWS];
+};
+
+struct Analysis;
+
+//-----------------------------------------------------------------------------
+// name: struct AnalysisWorker
+// desc: a pool thread and the shard it works on
+//-----------------------------------------------------------------------------
+struct AnalysisWorker
+{
+    Analysis * a;
+    unsigned int index;
+    pthread_t thread;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct Analysis
+// desc: analysis state; fields below `running` belong to the analysis thread
+//-----------------------------------------------------------------------------
+struct Analysis
+{
+    // configuration
+    unsigned int channels;
+    unsigned int fftSize;
+    unsigned int hop;
+    unsigned int sampleRate;
+    unsigned int bins;
+    float * window;
+    // transforms of the hop windows and the cqt windows, and double
+    // scratch for them [channels][longest window] (double precision only)
+    FftPlan * plan;
+    FftPlan * cqtPlan;
+    double * fftScratch;
+
+    // callback -> analysis, one ring per channel
+    SpscRing<float> * input;
+    // buffers the callback could not queue
+    std::atomic<uint64_t> dropped;
+
+    // analysis -> renderer triple buffer
+    AnalysisFrame slots[3];
+    std::atomic<int> middle;
+    int front;
+    // frames published
+    std::atomic<uint64_t> produced;
+
+    // spectrum history for the waterfall, [histSize][channels][bins],
+    // plus the overall peak of each entry
+    unsigned int histSize;
+    complex * history;
+    float * historyMax;
+    std::atomic<unsigned int> histCount;
+    std::atomic<unsigned int> histFilled;
+
+    // optional band map or cqt, bands per channel, their history
+    // [histSize][channels][bandCount] and per-channel |X| scratch
+    // [channels][bins]
+    BandMap * bandMap;
+    Cqt * cqt;
+    unsigned int bandCount;
+    complex * bandHistory;
+    float * mag;
+    float * bandOut;
+    // cqt: sliding windows [channels][cqt->fftSize], and their rfft()s
+    float * cqtFrames;
+    float * cqtSpectrum;
+
+    // optional sliding dft, fed from the rings ahead of the hop windows
+    Sdft * sdft;
+    float * sdftInput;
+
+    // beat tracker; descriptor scratch: each channel's last compressed
+    // magnitudes [channels][bins] and block energies, and the window's
+    // mean square
+    Beat * beat;
+    float * fluxPrev;
+    float * blocks;
+    float windowPower;
+    // pitch tracker, NULL if fftSize is too short for one at this rate
+    Pitch * pitch;
+
+    // per-view smoothing, its history [histSize][channels][count], and
+    // magnitude scratch [channels][max(bins, bandCount)]
+    Smooth * smooth[ANALYSIS_VIEWS];
+    complex * smoothHistory[ANALYSIS_VIEWS];
+    float * smoothMag;
+
+    // optional shared-memory feed
+    FeedHeader * feed;
+
+    pthread_t thread;
+    std::atomic<bool> running;
+
+    // worker pool: shard w is channels [shard[w], shard[w+1]); worker 0
+    // is the analysis thread itself.  pool threads are pinned to cpus
+    // outside `avoidCpus` (bit n = cpu n; the audio callback's)
+    unsigned int workers;
+    unsigned long long avoidCpus;
+    unsigned int shard[ANALYSIS_MAX_WORKERS + 1];
+    AnalysisWorker pool[ANALYSIS_MAX_WORKERS];
+    // hops posted to the pool, and shards of the current hop not yet done
+    std::atomic<uint64_t> posted;
+    std::atomic<unsigned int> remaining;
+    // idle pool threads sleep on poolWake, the analysis thread on hopDone
+    pthread_mutex_t poolLock;
+    pthread_cond_t poolWake;
+    pthread_cond_t hopDone;
+
+    // analysis thread: sliding windows [channels][fftSize], samples consumed
+    float * frames;
+    // every channel's window element-major, for rfft_batch(); each shard
+    // uses its own channels' part
+    float * batch;
+    uint64_t consumed;
+    int back;
+};
+
+
+// allocate everything for the given configuration
+Analysis * analysis_create( unsigned int channels, unsigned int fftSize, unsigned int hop,
+                            unsigned int sampleRate, unsigned int histSize );
+// stop (if running) and free
+void analysis_destroy( Analysis * a );
+// publish every spectrum to a shared-memory feed (before starting)
+void analysis_set_feed( Analysis * a, FeedHeader * feed );
+// also reduce every spectrum to map->bands bands (before starting; the
+// map stays owned by the caller)
+void analysis_set_bands( Analysis * a, BandMap * map );
+// or to a constant-Q spectrum (same frames and history as bands)
+void analysis_set_cqt( Analysis * a, Cqt * cqt );
+// fft precision for the spectra and the cqt (before starting;
+// analysis_create() plans float, callers pick their own default)
+void analysis_set_precision( Analysis * a, FftPrecision precision );
+// smooth what a view draws (after any bands are set, before starting)
+void analysis_set_smooth( Analysis * a, AnalysisView view, const SmoothParams * params );
+// also run a sliding dft of fftSize over the input (before starting; the
+// sdft stays owned by the caller)
+void analysis_set_sdft( Analysis * a, Sdft * sdft );
+// split channels over n threads, 0 = one per core (before starting);
+// returns the number actually used
+unsigned int analysis_set_workers( Analysis * a, unsigned int n );
+// keep the pool off these cpus, bit n = cpu n (before starting; default
+// cpu 0, where the callback is assumed to run)
+void analysis_avoid_cpus( Analysis * a, unsigned long long mask );
+// run analysis on its own thread
+bool analysis_start( Analysis * a );
+void analysis_stop( Analysis * a );
+
+// audio thread: queue non-interleaved input ([channels][frames])
+void analysis_push( Analysis * a, const float * input, unsigned int frames );
+// process every complete hop (and, first, every new sample for the
+// sliding dft) on the calling thread; returns hops done
+int analysis_process( Analysis * a );
+// hops queued but not yet analyzed
+unsigned int analysis_pending( const Analysis * a );
+
+// renderer: newest complete frame; *fresh is false if it was already seen
+const AnalysisFrame * analysis_latest( Analysis * a, bool * fresh );
+// renderer: spectrum in history slot index (< histFilled)
+const complex * analysis_history( const Analysis * a, unsigned int index, unsigned int channel );
+// renderer: bands in history slot index, NULL without bands
+const complex * analysis_band_history( const Analysis * a, unsigned int index, unsigned int channel );
+// renderer: a view's smoothed magnitudes in history slot index, NULL if
+// the view isn't smoothed
+const complex * analysis_smooth_history( const Analysis * a, AnalysisView view,
+                                         unsigned int index, unsigned int channel );
+
+
+#endif
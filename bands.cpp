@@ -0,0 +1,192 @@
+//-----------------------------------------------------------------------------
+// name: bands.cpp
+// desc: aggregate fft bins into log / mel / bark / octave bands
+//-----------------------------------------------------------------------------
+#include "bands.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+static const char * g_bandNames[] = { "none", "log", "mel", "bark", "octave", "cqt" };
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: bands_to()
+// desc: Hz to the scale (log and octave are both log2 Hz)
+//-----------------------------------------------------------------------------
+static double bands_to( BandScale scale, double f )
+{
+    switch( scale )
+    {
+        case BANDS_MEL: return 2595.0 * log10( 1.0 + f / 700.0 );
+        // Traunmueller's bark formula, which has a closed-form inverse
+        case BANDS_BARK: return 26.81 * f / ( 1960.0 + f ) - 0.53;
+        default: return log2( f );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: bands_from()
+// desc: the scale back to Hz
+//-----------------------------------------------------------------------------
+static double bands_from( BandScale scale, double s )
+{
+    switch( scale )
+    {
+        case BANDS_MEL: return 700.0 * ( pow( 10.0, s / 2595.0 ) - 1.0 );
+        case BANDS_BARK: return 1960.0 * ( s + 0.53 ) / ( 26.28 - s );
+        default: return exp2( s );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: bands_create()
+// desc: band edges equally spaced on the scale, weights per bin
+//-----------------------------------------------------------------------------
+BandMap * bands_create( BandScale scale, unsigned int bands, unsigned int fftSize, unsigned int sampleRate )
+{
+    unsigned int bins = fftSize / 2;
+    double binHz = (double)sampleRate / fftSize;
+    double lo = bands_to( scale, BANDS_FMIN );
+    double hi = bands_to( scale, sampleRate / 2.0 );
+    bool box = scale == BANDS_OCTAVE;
+    // triangles need a point past each end, boxes only their edges
+    unsigned int points = box ? bands + 1 : bands + 2;
+
+    std::vector<unsigned int> rowStart, firstBin;
+    std::vector<float> weight, center;
+    rowStart.push_back( 0 );
+
+    for( unsigned int r = 0; r < bands; r++ )
+    {
+        double a = lo + ( hi - lo ) * r / ( points - 1 );
+        double b = lo + ( hi - lo ) * ( r + ( box ? 1 : 2 ) ) / ( points - 1 );
+        double c = box ? ( a + b ) / 2 : lo + ( hi - lo ) * ( r + 1 ) / ( points - 1 );
+        center.push_back( (float)bands_from( scale, c ) );
+
+        // bins strictly inside the band (bin 0 holds DC and Nyquist)
+        long k0 = (long)ceil( bands_from( scale, a ) / binHz );
+        // boxes are half-open so neighbours never share a bin
+        long k1 = box ? (long)ceil( bands_from( scale, b ) / binHz ) - 1
+                      : (long)floor( bands_from( scale, b ) / binHz );
+        if( k0 < 1 ) k0 = 1;
+        if( k1 > (long)bins - 1 ) k1 = bins - 1;
+
+        std::vector<float> w;
+        long first = k0;
+        float sum = 0;
+        for( long k = k0; k <= k1; k++ )
+        {
+            double s = bands_to( scale, k * binHz );
+            float v = box ? 1.0f : (float)( s < c ? ( s - a ) / ( c - a ) : ( b - s ) / ( b - c ) );
+            if( v <= 0 ) v = 0;
+            // trim zero weights at the ends
+            if( w.empty() && v == 0 ) { first = k + 1; continue; }
+            w.push_back( v );
+            sum += v;
+        }
+        while( !w.empty() && w.back() == 0 ) w.pop_back();
+
+        // narrower than a bin: take the nearest one
+        if( sum == 0 )
+        {
+            long k = lround( bands_from( scale, c ) / binHz );
+            first = k < 1 ? 1 : ( k > (long)bins - 1 ? bins - 1 : k );
+            w.assign( 1, 1.0f );
+            sum = 1;
+        }
+
+        firstBin.push_back( (unsigned int)first );
+        for( size_t j = 0; j < w.size(); j++ )
+            weight.push_back( w[j] / sum );
+        rowStart.push_back( (unsigned int)weight.size() );
+    }
+
+    BandMap * map = new BandMap;
+    map->scale = scale;
+    map->bands = bands;
+    map->bins = bins;
+    map->rowStart = new unsigned int[bands + 1];
+    map->firstBin = new unsigned int[bands];
+    map->weight = new float[weight.size() ? weight.size() : 1];
+    map->center = new float[bands];
+    memcpy( map->rowStart, &rowStart[0], sizeof(unsigned int) * ( bands + 1 ) );
+    if( bands )
+    {
+        memcpy( map->firstBin, &firstBin[0], sizeof(unsigned int) * bands );
+        memcpy( map->center, &center[0], sizeof(float) * bands );
+    }
+    if( weight.size() )
+        memcpy( map->weight, &weight[0], sizeof(float) * weight.size() );
+    return map;
+}
+
+//-----------------------------------------------------------------------------
+// name: bands_destroy()
+// desc: free the matrix
+//-----------------------------------------------------------------------------
+void bands_destroy( BandMap * map )
+{
+    if( !map ) return;
+    delete [] map->rowStart;
+    delete [] map->firstBin;
+    delete [] map->weight;
+    delete [] map->center;
+    delete map;
+}
+
+//-----------------------------------------------------------------------------
+// name: bands_apply()
+// desc: one contiguous dot product per band; four partial sums so the
+//       adds don't serialize on one register
+//-----------------------------------------------------------------------------
+void bands_apply( const BandMap * map, const float * mag, float * out )
+{
+    for( unsigned int r = 0; r < map->bands; r++ )
+    {
+        const float * w = map->weight + map->rowStart[r];
+        const float * m = mag + map->firstBin[r];
+        unsigned int n = map->rowStart[r + 1] - map->rowStart[r];
+        float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        unsigned int j = 0;
+        for( ; j + 4 <= n; j += 4 )
+        {
+            s0 += w[j] * m[j];
+            s1 += w[j+1] * m[j+1];
+            s2 += w[j+2] * m[j+2];
+            s3 += w[j+3] * m[j+3];
+        }
+        for( ; j < n; j++ )
+            s0 += w[j] * m[j];
+        out[r] = ( s0 + s1 ) + ( s2 + s3 );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: bands_scale()
+// desc: scale by name
+//-----------------------------------------------------------------------------
+bool bands_scale( const char * name, BandScale * scale )
+{
+    for( int i = 0; i < (int)( sizeof(g_bandNames) / sizeof(g_bandNames[0]) ); i++ )
+    {
+        if( !strcmp( name, g_bandNames[i] ) )
+        {
+            *scale = (BandScale)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// name: bands_name()
+// desc: name of a scale
+//-----------------------------------------------------------------------------
+const char * bands_name( BandScale scale )
+{
+    return g_bandNames[scale];
+}
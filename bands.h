@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+// name: bands.h
+// desc: aggregate fft bins into log / mel / bark / octave bands
+//
+//   the weights are a sparse matrix (bands x bins) built once.  every band
+//   covers a contiguous run of bins, so each row is stored as its first
+//   bin plus a dense run of weights (CSR without the column array) and
+//   applying it is one short dot product per band.  rows are normalized
+//   to sum to one: a band is the weighted mean |X| of its bins, on the
+//   same scale as a single bin.
+//-----------------------------------------------------------------------------
+#ifndef __BANDS_H__
+#define __BANDS_H__
+
+
+// frequency scales; BANDS_CQT is a constant-Q transform (cqt.h), not a
+// band map
+enum BandScale { BANDS_NONE = 0, BANDS_LOG, BANDS_MEL, BANDS_BARK, BANDS_OCTAVE, BANDS_CQT };
+
+// lowest band edge, Hz
+#define BANDS_FMIN 30.0f
+
+
+//-----------------------------------------------------------------------------
+// name: struct BandMap
+// desc: sparse weights, row r = weight[rowStart[r] .. rowStart[r+1]) on
+//       bins firstBin[r] ...
+//-----------------------------------------------------------------------------
+struct BandMap
+{
+    BandScale scale;
+    unsigned int bands;
+    unsigned int bins;
+    unsigned int * rowStart;
+    unsigned int * firstBin;
+    float * weight;
+    // band centers, Hz
+    float * center;
+};
+
+
+// weights for `bands` bands over the bins of an fftSize-point rfft():
+// triangular filters for log/mel/bark, adjacent boxes for octave
+BandMap * bands_create( BandScale scale, unsigned int bands, unsigned int fftSize, unsigned int sampleRate );
+void bands_destroy( BandMap * map );
+// out[r] = sum of weight * mag over band r's bins
+void bands_apply( const BandMap * map, const float * mag, float * out );
+// parse "log", "mel", "bark", "octave", "cqt" or "none"; false if unknown
+bool bands_scale( const char * name, BandScale * scale );
+const char * bands_name( BandScale scale );
+
+
+#endif
@@ -0,0 +1,149 @@
+//-----------------------------------------------------------------------------
+// name: beat.cpp
+// desc: spectral-flux onsets and an incremental tempo / beat tracker
+//-----------------------------------------------------------------------------
+#include "beat.h"
+#include <math.h>
+#include <string.h>
+
+
+// onset: flux above mean + this many deviations
+#define BEAT_THRESHOLD 1.5f
+// shortest gap between onsets, seconds
+#define BEAT_MIN_GAP 0.05f
+// time constants: onset statistics, tempo memory, pulse decay, seconds
+#define BEAT_STAT_TIME 1.0f
+#define BEAT_MEMORY 6.0f
+#define BEAT_PULSE_TIME 0.15f
+// tempo prior: centered on 120 bpm, this many octaves wide
+#define BEAT_PRIOR_BPM 120.0f
+#define BEAT_PRIOR_OCTAVES 1.0f
+// how far an onset pulls the phase towards it (0..1)
+#define BEAT_LOCK 0.2f
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: beat_create()
+// desc: lag range, prior and zeroed history
+//-----------------------------------------------------------------------------
+Beat * beat_create( float hopRate )
+{
+    Beat * b = new Beat;
+    b->hopRate = hopRate;
+    b->minLag = (unsigned int)floorf( hopRate * 60.0f / BEAT_MAX_BPM );
+    if( b->minLag < 1 ) b->minLag = 1;
+    // one past the slowest tempo, for the interpolation
+    b->maxLag = (unsigned int)ceilf( hopRate * 60.0f / BEAT_MIN_BPM ) + 1;
+    if( b->maxLag < b->minLag + 2 ) b->maxLag = b->minLag + 2;
+
+    b->mean = 0;
+    b->dev = 0;
+    memset( b->last, 0, sizeof(b->last) );
+    b->sinceOnset = 0;
+
+    b->history = new float[b->maxLag + 1];
+    b->acf = new float[b->maxLag + 1];
+    b->prior = new float[b->maxLag + 1];
+    memset( b->history, 0, sizeof(float) * ( b->maxLag + 1 ) );
+    memset( b->acf, 0, sizeof(float) * ( b->maxLag + 1 ) );
+    for( unsigned int lag = 0; lag <= b->maxLag; lag++ )
+    {
+        float octaves = lag ? log2f( 60.0f * hopRate / lag / BEAT_PRIOR_BPM ) / BEAT_PRIOR_OCTAVES : 0;
+        b->prior[lag] = expf( -0.5f * octaves * octaves );
+    }
+    b->head = 0;
+    b->hops = 0;
+    b->period = 60.0f * hopRate / BEAT_PRIOR_BPM;
+
+    b->acfDecay = expf( -1.0f / ( hopRate * BEAT_MEMORY ) );
+    b->statDecay = 1.0f - expf( -1.0f / ( hopRate * BEAT_STAT_TIME ) );
+    b->pulseDecay = expf( -1.0f / ( hopRate * BEAT_PULSE_TIME ) );
+
+    memset( &b->state, 0, sizeof(BeatState) );
+    return b;
+}
+
+//-----------------------------------------------------------------------------
+// name: beat_destroy()
+// desc: free the history
+//-----------------------------------------------------------------------------
+void beat_destroy( Beat * b )
+{
+    if( !b ) return;
+    delete [] b->history;
+    delete [] b->acf;
+    delete [] b->prior;
+    delete b;
+}
+
+//-----------------------------------------------------------------------------
+// name: beat_tempo()
+// desc: strongest prior-weighted lag, refined with a parabola
+//-----------------------------------------------------------------------------
+static void beat_tempo( Beat * b )
+{
+    unsigned int best = 0;
+    float top = 0;
+    for( unsigned int lag = b->minLag + 1; lag < b->maxLag; lag++ )
+    {
+        float v = b->acf[lag] * b->prior[lag];
+        if( v > top ) { top = v; best = lag; }
+    }
+    if( !best ) return;
+
+    float y0 = b->acf[best-1] * b->prior[best-1];
+    float y2 = b->acf[best+1] * b->prior[best+1];
+    float den = y0 - 2 * top + y2;
+    float offset = den < 0 ? 0.5f * ( y0 - y2 ) / den : 0;
+    b->period = best + offset;
+    b->state.bpm = 60.0f * b->hopRate / b->period;
+}
+
+//-----------------------------------------------------------------------------
+// name: beat_update()
+// desc: peak-pick an onset (one hop late), update the autocorrelation and
+//       advance the beat oscillator
+//-----------------------------------------------------------------------------
+void beat_update( Beat * b, float flux )
+{
+    BeatState * s = &b->state;
+    unsigned int size = b->maxLag + 1;
+
+    // last[1] is an onset if it is a local peak well above the recent level
+    b->last[0] = b->last[1];
+    b->last[1] = b->last[2];
+    b->last[2] = flux;
+    b->sinceOnset++;
+    bool onset = b->last[1] > b->last[0] && b->last[1] >= b->last[2] &&
+                 b->last[1] > b->mean + BEAT_THRESHOLD * b->dev &&
+                 b->sinceOnset > BEAT_MIN_GAP * b->hopRate;
+    if( onset ) b->sinceOnset = 0;
+
+    // the part above the mean drives the tempo
+    float strength = flux > b->mean ? flux - b->mean : 0;
+    b->mean += b->statDecay * ( flux - b->mean );
+    b->dev += b->statDecay * ( fabsf( flux - b->mean ) - b->dev );
+
+    b->history[b->head] = strength;
+    for( unsigned int lag = b->minLag - 1; lag <= b->maxLag; lag++ )
+        b->acf[lag] = b->acf[lag] * b->acfDecay + strength * b->history[( b->head + size - lag ) % size];
+    b->head = ( b->head + 1 ) % size;
+    if( ++b->hops > b->maxLag )
+        beat_tempo( b );
+
+    // advance, then pull the phase the onset had (a hop ago) towards 0
+    s->phase += 1.0f / b->period;
+    if( onset )
+    {
+        float at = s->phase - 1.0f / b->period;
+        s->phase -= BEAT_LOCK * ( at - floorf( at + 0.5f ) );
+    }
+    while( s->phase >= 1.0f ) { s->phase -= 1.0f; s->beats++; }
+    while( s->phase < 0.0f ) s->phase += 1.0f;
+
+    s->flux = flux;
+    s->onset = onset;
+    s->pulse = onset ? 1.0f : s->pulse * b->pulseDecay;
+}
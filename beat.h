@@ -0,0 +1,82 @@
+//-----------------------------------------------------------------------------
+// name: beat.h
+// desc: spectral-flux onsets and an incremental tempo / beat tracker
+//
+//   every hop, the onset strength is the spectral flux (descriptors.h):
+//   the summed increase of log-compressed magnitudes since the previous
+//   hop, over all channels.  onsets
+//   are its local peaks above a running mean plus a multiple of its
+//   running deviation.  tempo comes from an exponentially decaying
+//   autocorrelation of the onset strength, updated one hop at a time over
+//   the lags of 60..200 bpm and weighted towards 120 bpm; the beat phase
+//   is an oscillator at that period which onsets pull into line.  all
+//   state is allocated up front.
+//-----------------------------------------------------------------------------
+#ifndef __BEAT_H__
+#define __BEAT_H__
+
+#include <stdint.h>
+
+
+// tempo range, bpm
+#define BEAT_MIN_BPM 60.0f
+#define BEAT_MAX_BPM 200.0f
+
+
+//-----------------------------------------------------------------------------
+// name: struct BeatState
+// desc: what the renderer gets, once per hop
+//-----------------------------------------------------------------------------
+struct BeatState
+{
+    // onset strength, and whether this hop holds an onset
+    float flux;
+    bool onset;
+    // tempo (0 until the tracker has heard enough), and position in the
+    // beat: 0 on the beat, rising to 1 just before the next one
+    float bpm;
+    float phase;
+    // 1 at an onset, decaying towards 0 in between
+    float pulse;
+    // beats counted
+    uint64_t beats;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct Beat
+// desc: tracker state
+//-----------------------------------------------------------------------------
+struct Beat
+{
+    float hopRate;
+    unsigned int minLag;
+    unsigned int maxLag;
+    // onset strength statistics and the last three values (peak picking)
+    float mean;
+    float dev;
+    float last[3];
+    unsigned int sinceOnset;
+    // onset strength over the last maxLag + 1 hops, and its decayed
+    // autocorrelation per lag, with the tempo prior per lag
+    float * history;
+    unsigned int head;
+    uint64_t hops;
+    float * acf;
+    float * prior;
+    float period;
+    // per-hop decay of the autocorrelation, the statistics and the pulse
+    float acfDecay;
+    float statDecay;
+    float pulseDecay;
+    BeatState state;
+};
+
+
+// tracker for a given hop rate (hops per second)
+Beat * beat_create( float hopRate );
+void beat_destroy( Beat * b );
+// advance one hop with the flux summed over channels
+void beat_update( Beat * b, float flux );
+
+
+#endif
@@ -0,0 +1,197 @@
+//-----------------------------------------------------------------------------
+// name: capture.cpp
+// desc: record the audio callback's input to a compact binary log, and
+//       read it back for deterministic replay
+//-----------------------------------------------------------------------------
+#include "capture.h"
+#include <string.h>
+#include <time.h>
+
+
+// how long the writer sleeps when the ring is empty, ns
+#define CAPTURE_IDLE_NS 10000000L
+// largest chunk the writer hands to fwrite at once
+#define CAPTURE_CHUNK (64 << 10)
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: capture_drain()
+// desc: move everything queued so far to the file
+//-----------------------------------------------------------------------------
+static size_t capture_drain( Capture * cap, char * chunk )
+{
+    size_t total = 0;
+    size_t n;
+    while( ( n = cap->ring.readable() ) > 0 )
+    {
+        if( n > CAPTURE_CHUNK ) n = CAPTURE_CHUNK;
+        cap->ring.pop( chunk, n );
+        fwrite( chunk, 1, n, cap->file );
+        total += n;
+    }
+    return total;
+}
+
+//-----------------------------------------------------------------------------
+// name: capture_thread()
+// desc: writer thread
+//-----------------------------------------------------------------------------
+static void * capture_thread( void * data )
+{
+    Capture * cap = (Capture *)data;
+    char * chunk = new char[CAPTURE_CHUNK];
+    struct timespec idle = { 0, CAPTURE_IDLE_NS };
+
+    while( cap->running.load( std::memory_order_acquire ) )
+    {
+        if( capture_drain( cap, chunk ) == 0 )
+            nanosleep( &idle, NULL );
+    }
+    // whatever arrived before the stop
+    capture_drain( cap, chunk );
+
+    delete [] chunk;
+    return NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: capture_start()
+// desc: write the header and start the writer thread
+//-----------------------------------------------------------------------------
+Capture * capture_start( const char * path, unsigned int sampleRate,
+                         unsigned int channels, unsigned int bufferFrames )
+{
+    FILE * file = fopen( path, "wb" );
+    if( !file ) return NULL;
+
+    CaptureHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.magic, CAPTURE_MAGIC, sizeof(header.magic) );
+    header.version = CAPTURE_VERSION;
+    header.sampleRate = sampleRate;
+    header.channels = channels;
+    header.bufferFrames = bufferFrames;
+    if( fwrite( &header, sizeof(header), 1, file ) != 1 )
+    {
+        fclose( file );
+        return NULL;
+    }
+
+    Capture * cap = new Capture;
+    cap->file = file;
+    cap->channels = channels;
+    cap->ring.init( CAPTURE_RING_BYTES );
+    cap->dropped.store( 0 );
+    cap->records = 0;
+    cap->running.store( true );
+    if( pthread_create( &cap->thread, NULL, capture_thread, cap ) )
+    {
+        fclose( file );
+        delete cap;
+        return NULL;
+    }
+
+    return cap;
+}
+
+//-----------------------------------------------------------------------------
+// name: capture_write()
+// desc: queue header and samples as one unit, or drop the record
+//-----------------------------------------------------------------------------
+void capture_write( Capture * cap, const float * input, unsigned int frames,
+                    double streamTime, unsigned int status )
+{
+    if( !cap->running.load( std::memory_order_relaxed ) ) return;
+
+    size_t bytes = sizeof(float) * frames * cap->channels;
+    // we are the only producer, so the space can only grow after this check
+    if( cap->ring.writable() < sizeof(CaptureRecord) + bytes )
+    {
+        cap->dropped.store( cap->dropped.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+        return;
+    }
+
+    CaptureRecord record;
+    record.frames = frames;
+    record.status = status;
+    record.streamTime = streamTime;
+    cap->ring.push( (const char *)&record, sizeof(record) );
+    cap->ring.push( (const char *)input, bytes );
+    cap->records++;
+}
+
+//-----------------------------------------------------------------------------
+// name: capture_stop()
+// desc: stop accepting, flush and close
+//-----------------------------------------------------------------------------
+void capture_stop( Capture * cap )
+{
+    if( !cap ) return;
+
+    cap->running.store( false, std::memory_order_release );
+    pthread_join( cap->thread, NULL );
+    fclose( cap->file );
+
+    uint64_t dropped = cap->dropped.load();
+    if( dropped )
+        fprintf( stderr, "[sound-sphere]: capture dropped %llu of %llu buffers\n",
+                 (unsigned long long)dropped, (unsigned long long)(cap->records + dropped) );
+    delete cap;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: replay_open()
+// desc: open a log and check its header
+//-----------------------------------------------------------------------------
+Replay * replay_open( const char * path )
+{
+    FILE * file = fopen( path, "rb" );
+    if( !file ) return NULL;
+
+    Replay * rep = new Replay;
+    rep->file = file;
+    if( fread( &rep->header, sizeof(CaptureHeader), 1, file ) != 1 ||
+        memcmp( rep->header.magic, CAPTURE_MAGIC, sizeof(rep->header.magic) ) ||
+        rep->header.version != CAPTURE_VERSION ||
+        rep->header.channels == 0 || rep->header.bufferFrames == 0 )
+    {
+        replay_close( rep );
+        return NULL;
+    }
+
+    return rep;
+}
+
+//-----------------------------------------------------------------------------
+// name: replay_next()
+// desc: next callback's worth of input
+//-----------------------------------------------------------------------------
+bool replay_next( Replay * rep, float * buffer, CaptureRecord * record )
+{
+    if( fread( record, sizeof(CaptureRecord), 1, rep->file ) != 1 )
+        return false;
+    if( record->frames == 0 || record->frames > rep->header.bufferFrames )
+        return false;
+
+    size_t samples = (size_t)record->frames * rep->header.channels;
+    return fread( buffer, sizeof(float), samples, rep->file ) == samples;
+}
+
+//-----------------------------------------------------------------------------
+// name: replay_close()
+// desc: close the log
+//-----------------------------------------------------------------------------
+void replay_close( Replay * rep )
+{
+    if( !rep ) return;
+    fclose( rep->file );
+    delete rep;
+}
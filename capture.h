@@ -0,0 +1,102 @@
+//-----------------------------------------------------------------------------
+// name: capture.h
+// desc: record the audio callback's input to a compact binary log, and
+//       read it back for deterministic replay
+//
+//   log layout (host byte order):
+//     CaptureHeader
+//     repeated: CaptureRecord, then frames * channels floats exactly as
+//               the callback received them (non-interleaved)
+//
+//   the callback only copies into a lock-free ring; a writer thread does
+//   the file i/o.  if the writer falls behind, whole records are dropped
+//   and counted rather than blocking the callback.
+//-----------------------------------------------------------------------------
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "ringbuffer.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+// "SSCAP\0\0\0"
+#define CAPTURE_MAGIC "SSCAP\0\0"
+#define CAPTURE_VERSION 1
+// default ring size: several seconds of multichannel audio
+#define CAPTURE_RING_BYTES (8 << 20)
+
+
+//-----------------------------------------------------------------------------
+// name: struct CaptureHeader
+// desc: start of a log file
+//-----------------------------------------------------------------------------
+struct CaptureHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t channels;
+    // buffer size the stream was opened with
+    uint32_t bufferFrames;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct CaptureRecord
+// desc: one callback
+//-----------------------------------------------------------------------------
+struct CaptureRecord
+{
+    uint32_t frames;
+    uint32_t status;
+    double streamTime;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct Capture
+// desc: recording state
+//-----------------------------------------------------------------------------
+struct Capture
+{
+    FILE * file;
+    unsigned int channels;
+    SpscRing<char> ring;
+    pthread_t thread;
+    std::atomic<bool> running;
+    // records the callback could not queue
+    std::atomic<uint64_t> dropped;
+    uint64_t records;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct Replay
+// desc: playback state
+//-----------------------------------------------------------------------------
+struct Replay
+{
+    FILE * file;
+    CaptureHeader header;
+};
+
+
+// start recording to path; NULL on failure
+Capture * capture_start( const char * path, unsigned int sampleRate,
+                         unsigned int channels, unsigned int bufferFrames );
+// queue one callback's input (audio thread)
+void capture_write( Capture * cap, const float * input, unsigned int frames,
+                    double streamTime, unsigned int status );
+// drain the ring, join the writer and close the file
+void capture_stop( Capture * cap );
+
+// open a log for replay; NULL on failure
+Replay * replay_open( const char * path );
+// read the next record into buffer (room for bufferFrames * channels
+// floats); false at end of file or on a malformed record
+bool replay_next( Replay * rep, float * buffer, CaptureRecord * record );
+// close
+void replay_close( Replay * rep );
+
+
+#endif
@@ -214,6 +214,14 @@ void cfft( float * x, long NC, unsigned int forward )
     float wr, wi, wpr, wpi, theta, scale ;
     long mmax, ND, m, i, j, delta ;
     ND = NC<<1 ;
+    
+    // rfft() used to be the only caller and set these up
+    if( !TWOPI )
+    {
+        PI = (float) (4.*atan( 1. )) ;
+        TWOPI = (float) (8.*atan( 1. )) ;
+    }
+    
     bit_reverse( x, ND ) ;
     
     for( mmax = 2 ; mmax < ND ; mmax = delta )
@@ -277,4 +285,152 @@ void bit_reverse( float * x, long N )
         for( m = N>>1 ; m >= 2 && j >= m ; m >>= 1 )
             j -= m ;
     }
-}
\ No newline at end of file
+}
+
+
+
+//-----------------------------------------------------------------------------
+// name: rfft_batch()
+// desc: rfft() of K signals stored element-major (see chuck_fft.h); the
+//       twiddle recurrence is shared, only the butterflies run per signal
+//-----------------------------------------------------------------------------
+void rfft_batch( float * x, long N, long K, unsigned int forward )
+{
+    float c1, c2, h1r, h1i, h2r, h2i, wr, wi, wpr, wpi, temp, theta ;
+    float a, b ;
+    long i, k ;
+    float *x1, *x2, *x3, *x4 ;
+    
+    if( !PI )
+    {
+        PI = (float) (4.*atan( 1. )) ;
+        TWOPI = (float) (8.*atan( 1. )) ;
+    }
+    
+    theta = PI/N ;
+    c1 = 0.5 ;
+    
+    if( forward )
+    {
+        c2 = -0.5 ;
+        cfft_batch( x, N, K, forward ) ;
+    }
+    else
+    {
+        c2 = 0.5 ;
+        theta = -theta ;
+    }
+    
+    // i == 0: DC and Nyquist share x[0] and x[1] (w is 1 here)
+    for( k = 0 ; k < K ; k++ )
+    {
+        a = x[k] ;
+        b = x[K+k] ;
+        x[k] = forward ? a + b : c1*(a + b) ;
+        x[K+k] = forward ? a - b : c2*(a - b) ;
+    }
+    
+    wpr = (float) (-2.*pow( sin( 0.5*theta ), 2. )) ;
+    wpi = (float) sin( theta ) ;
+    wr = 1. + wpr ;
+    wi = wpi ;
+    
+    for( i = 1 ; i <= N>>1 ; i++ )
+    {
+        x1 = x + (i<<1)*K ;
+        x2 = x1 + K ;
+        x3 = x + ((N<<1) - (i<<1))*K ;
+        x4 = x3 + K ;
+        for( k = 0 ; k < K ; k++ )
+        {
+            h1r =  c1*(x1[k] + x3[k] ) ;
+            h1i =  c1*(x2[k] - x4[k] ) ;
+            h2r = -c2*(x2[k] + x4[k] ) ;
+            h2i =  c2*(x1[k] - x3[k] ) ;
+            x1[k] =  h1r + wr*h2r - wi*h2i ;
+            x2[k] =  h1i + wr*h2i + wi*h2r ;
+            x3[k] =  h1r - wr*h2r + wi*h2i ;
+            x4[k] = -h1i + wr*h2i + wi*h2r ;
+        }
+        
+        wr = (temp = wr)*wpr - wi*wpi + wr ;
+        wi = wi*wpr + temp*wpi + wi ;
+    }
+    
+    if( !forward )
+        cfft_batch( x, N, K, forward ) ;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: cfft_batch()
+// desc: cfft() of K signals stored element-major (see chuck_fft.h)
+//-----------------------------------------------------------------------------
+void cfft_batch( float * x, long NC, long K, unsigned int forward )
+{
+    float wr, wi, wpr, wpi, theta, scale, rtemp, itemp, t ;
+    long mmax, ND, m, i, j, k, delta ;
+    float *xi, *xj ;
+    ND = NC<<1 ;
+    
+    if( !TWOPI )
+    {
+        PI = (float) (4.*atan( 1. )) ;
+        TWOPI = (float) (8.*atan( 1. )) ;
+    }
+    
+    // bit reversal, swapping whole rows of K values
+    for( i = j = 0 ; i < ND ; i += 2, j += m )
+    {
+        if( j > i )
+        {
+            xi = x + i*K ;
+            xj = x + j*K ;
+            for( k = 0 ; k < 2*K ; k++ )
+            {
+                t = xj[k] ; xj[k] = xi[k] ; xi[k] = t ;
+            }
+        }
+        
+        for( m = ND>>1 ; m >= 2 && j >= m ; m >>= 1 )
+            j -= m ;
+    }
+    
+    for( mmax = 2 ; mmax < ND ; mmax = delta )
+    {
+        delta = mmax<<1 ;
+        theta = TWOPI/( forward? mmax : -mmax ) ;
+        wpr = (float) (-2.*pow( sin( 0.5*theta ), 2. )) ;
+        wpi = (float) sin( theta ) ;
+        wr = 1. ;
+        wi = 0. ;
+        
+        for( m = 0 ; m < mmax ; m += 2 )
+        {
+            for( i = m ; i < ND ; i += delta )
+            {
+                xi = x + i*K ;
+                xj = x + (i + mmax)*K ;
+                for( k = 0 ; k < K ; k++ )
+                {
+                    rtemp = wr*xj[k] - wi*xj[K+k] ;
+                    itemp = wr*xj[K+k] + wi*xj[k] ;
+                    xj[k] = xi[k] - rtemp ;
+                    xj[K+k] = xi[K+k] - itemp ;
+                    xi[k] += rtemp ;
+                    xi[K+k] += itemp ;
+                }
+            }
+            
+            wr = (rtemp = wr)*wpr - wi*wpi + wr ;
+            wi = wi*wpr + rtemp*wpi + wi ;
+        }
+    }
+    
+    // scale output
+    scale = (float)(forward ? 1./ND : 2.) ;
+    for( i = 0 ; i < ND*K ; i++ )
+        x[i] *= scale ;
+}
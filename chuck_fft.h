@@ -36,6 +36,13 @@ extern "C" {
     void rfft( float * x, long N, unsigned int forward );
     // complex fft, NC must be power of 2
     void cfft( float * x, long NC, unsigned int forward );
+
+    // batched versions: K signals of the same length transformed at once,
+    // stored element by element (element e of signal k at x[e*K + k]) so
+    // the innermost loops run across signals and vectorize; each signal's
+    // result is the same as rfft()/cfft() on it alone
+    void rfft_batch( float * x, long N, long K, unsigned int forward );
+    void cfft_batch( float * x, long NC, long K, unsigned int forward );
     
     // c linkage
 #if ( defined( __cplusplus ) || defined( _cplusplus ) )
@@ -5,7 +5,7 @@ Color colorSpectrum(double w) {
     if (w<0)w=0;
     
     w=w*(645-380)+380;
-    Color color = {};
+    Color color = {0};
     double R,B,G;
     if (w >= 380 && w < 440){
         R = -(w - 440.) /(440. - 350.);
@@ -46,4 +46,52 @@ Color colorSpectrum(double w) {
     color.G = G;
     color.B = B;
     return color;
-}
\ No newline at end of file
+}
+// colorSpectrum() sampled at COLOR_LUT_SIZE + 1 points, one array per
+// component so the batch loops read them the same way
+static float g_lutR[COLOR_LUT_SIZE + 1];
+static float g_lutG[COLOR_LUT_SIZE + 1];
+static float g_lutB[COLOR_LUT_SIZE + 1];
+static int g_lutReady = 0;
+
+void colorInit(void) {
+    for (int i = 0; i <= COLOR_LUT_SIZE; i++) {
+        Color color = colorSpectrum((double)i / COLOR_LUT_SIZE);
+        g_lutR[i] = (float)color.R;
+        g_lutG[i] = (float)color.G;
+        g_lutB[i] = (float)color.B;
+    }
+    g_lutReady = 1;
+}
+
+void colorSpectrumBatch(const float * w, float * rgb, long n) {
+    if (!g_lutReady) colorInit();
+    
+    // no branches: clamp, split into index and fraction, lerp
+    for (long i = 0; i < n; i++) {
+        float x = w[i] < 0 ? 0 : (w[i] > 1 ? 1 : w[i]);
+        x *= COLOR_LUT_SIZE;
+        int j = (int)x;
+        j = j < COLOR_LUT_SIZE ? j : COLOR_LUT_SIZE - 1;
+        float f = x - j;
+        rgb[3*i]   = g_lutR[j] + f*(g_lutR[j+1] - g_lutR[j]);
+        rgb[3*i+1] = g_lutG[j] + f*(g_lutG[j+1] - g_lutG[j]);
+        rgb[3*i+2] = g_lutB[j] + f*(g_lutB[j+1] - g_lutB[j]);
+    }
+}
+
+void colorSpectrumBatch8(const float * w, unsigned char * rgba, long n) {
+    if (!g_lutReady) colorInit();
+    
+    for (long i = 0; i < n; i++) {
+        float x = w[i] < 0 ? 0 : (w[i] > 1 ? 1 : w[i]);
+        x *= COLOR_LUT_SIZE;
+        int j = (int)x;
+        j = j < COLOR_LUT_SIZE ? j : COLOR_LUT_SIZE - 1;
+        float f = x - j;
+        rgba[4*i]   = (unsigned char)(255.f*(g_lutR[j] + f*(g_lutR[j+1] - g_lutR[j])) + .5f);
+        rgba[4*i+1] = (unsigned char)(255.f*(g_lutG[j] + f*(g_lutG[j+1] - g_lutG[j])) + .5f);
+        rgba[4*i+2] = (unsigned char)(255.f*(g_lutB[j] + f*(g_lutB[j+1] - g_lutB[j])) + .5f);
+        rgba[4*i+3] = 255;
+    }
+}
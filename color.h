@@ -4,4 +4,14 @@ typedef struct {
     double B;
 } Color;
 
+// entries in the lookup table (plus one so the last one interpolates)
+#define COLOR_LUT_SIZE 1024
+
 Color colorSpectrum(double w);
+
+// build the lookup table (done on first use too)
+void colorInit(void);
+// colorSpectrum() for n values of w at once, interpolated from the table:
+// rgb gets 3 floats per value, rgba 4 bytes per value (alpha 255)
+void colorSpectrumBatch(const float * w, float * rgb, long n);
+void colorSpectrumBatch8(const float * w, unsigned char * rgba, long n);
@@ -0,0 +1,206 @@
+//-----------------------------------------------------------------------------
+// name: colormap.cpp
+// desc: draw spectrum rings on the GPU with a 1D-texture colormap
+//-----------------------------------------------------------------------------
+#include "colormap.h"
+#include "color.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __MACOSX_CORE__
+#include <OpenGL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+
+// displaced by 10*sqrt(|X|) like drawCircle(), colored by sqrt(|X|)
+static const char * g_vertexShader =
+    "#version 110\n"
+    "attribute float bin;\n"
+    "attribute vec2 spectrum;\n"
+    "uniform float bins;\n"
+    "uniform float radius;\n"
+    "varying float level;\n"
+    "void main()\n"
+    "{\n"
+    "    float mag = length( spectrum );\n"
+    "    float r = radius + ( mag <= 1.0 ? 10.0 * sqrt( mag ) : 0.0 );\n"
+    "    float angle = 6.28318531 * bin / bins;\n"
+    "    level = sqrt( mag );\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4( r * cos( angle ), r * sin( angle ), 0.0, 1.0 );\n"
+    "}\n";
+
+// texel centers span [0, 1] exactly
+static const char * g_fragmentShader =
+    "#version 110\n"
+    "uniform sampler1D map;\n"
+    "uniform bool useMap;\n"
+    "uniform float size;\n"
+    "varying float level;\n"
+    "void main()\n"
+    "{\n"
+    "    float x = ( clamp( level, 0.0, 1.0 ) * ( size - 1.0 ) + 0.5 ) / size;\n"
+    "    gl_FragColor = useMap ? texture1D( map, x ) : gl_Color;\n"
+    "}\n";
+
+static GLuint g_program = 0;
+static GLuint g_texture = 0;
+// bin indices 0 .. g_binCount - 1; any ring with fewer bins draws a prefix
+static GLuint g_binBuffer = 0;
+static long g_binCount = 0;
+static GLint g_aBin, g_aSpectrum, g_uBins, g_uRadius, g_uMap, g_uUseMap, g_uSize;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: colormap_compile()
+// desc: compile one shader, print the log on failure
+//-----------------------------------------------------------------------------
+static GLuint colormap_compile( GLenum type, const char * source )
+{
+    GLuint shader = glCreateShader( type );
+    glShaderSource( shader, 1, &source, NULL );
+    glCompileShader( shader );
+
+    GLint ok = 0;
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &ok );
+    if( !ok )
+    {
+        char log[1024];
+        glGetShaderInfoLog( shader, sizeof(log), NULL, log );
+        fprintf( stderr, "[sound-sphere]: shader: %s\n", log );
+        glDeleteShader( shader );
+        return 0;
+    }
+    return shader;
+}
+
+//-----------------------------------------------------------------------------
+// name: colormap_init()
+// desc: program, attribute/uniform locations and the colormap texture
+//-----------------------------------------------------------------------------
+bool colormap_init()
+{
+    const char * version = (const char *)glGetString( GL_VERSION );
+    if( !version || atoi( version ) < 2 )
+    {
+        fprintf( stderr, "[sound-sphere]: OpenGL %s, drawing spectra on the CPU\n",
+                 version ? version : "(unknown)" );
+        return false;
+    }
+
+    GLuint vs = colormap_compile( GL_VERTEX_SHADER, g_vertexShader );
+    GLuint fs = colormap_compile( GL_FRAGMENT_SHADER, g_fragmentShader );
+    if( !vs || !fs ) return false;
+
+    GLuint program = glCreateProgram();
+    glAttachShader( program, vs );
+    glAttachShader( program, fs );
+    // some drivers only draw when generic attribute 0 is in use
+    glBindAttribLocation( program, 0, "bin" );
+    glLinkProgram( program );
+    glDeleteShader( vs );
+    glDeleteShader( fs );
+
+    GLint ok = 0;
+    glGetProgramiv( program, GL_LINK_STATUS, &ok );
+    if( !ok )
+    {
+        char log[1024];
+        glGetProgramInfoLog( program, sizeof(log), NULL, log );
+        fprintf( stderr, "[sound-sphere]: shader link: %s\n", log );
+        glDeleteProgram( program );
+        return false;
+    }
+
+    g_aBin = glGetAttribLocation( program, "bin" );
+    g_aSpectrum = glGetAttribLocation( program, "spectrum" );
+    g_uBins = glGetUniformLocation( program, "bins" );
+    g_uRadius = glGetUniformLocation( program, "radius" );
+    g_uMap = glGetUniformLocation( program, "map" );
+    g_uUseMap = glGetUniformLocation( program, "useMap" );
+    g_uSize = glGetUniformLocation( program, "size" );
+
+    // the colormap: colorSpectrum() at evenly spaced levels
+    float level[COLOR_LUT_SIZE];
+    unsigned char rgba[4 * COLOR_LUT_SIZE];
+    for( int i = 0; i < COLOR_LUT_SIZE; i++ )
+        level[i] = (float)i / ( COLOR_LUT_SIZE - 1 );
+    colorSpectrumBatch8( level, rgba, COLOR_LUT_SIZE );
+
+    glGenTextures( 1, &g_texture );
+    glBindTexture( GL_TEXTURE_1D, g_texture );
+    glTexParameteri( GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexImage1D( GL_TEXTURE_1D, 0, GL_RGBA8, COLOR_LUT_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba );
+    glBindTexture( GL_TEXTURE_1D, 0 );
+
+    glGenBuffers( 1, &g_binBuffer );
+    g_program = program;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// name: colormap_ready()
+// desc: is the GPU path available
+//-----------------------------------------------------------------------------
+bool colormap_ready()
+{
+    return g_program != 0;
+}
+
+//-----------------------------------------------------------------------------
+// name: colormap_bins()
+// desc: bind the static bin index buffer, growing it to the next power of
+//       two only when a ring has more bins than it holds
+//-----------------------------------------------------------------------------
+static void colormap_bins( long bins )
+{
+    glBindBuffer( GL_ARRAY_BUFFER, g_binBuffer );
+    if( bins > g_binCount )
+    {
+        long count = 1024;
+        while( count < bins ) count <<= 1;
+        float * index = new float[count];
+        for( long i = 0; i < count; i++ )
+            index[i] = (float)i;
+        glBufferData( GL_ARRAY_BUFFER, sizeof(float) * count, index, GL_STATIC_DRAW );
+        delete [] index;
+        g_binCount = count;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: colormap_ring()
+// desc: one ring; the only per-frame upload is the spectrum itself
+//-----------------------------------------------------------------------------
+void colormap_ring( const complex * spectrum, long bins, float radius, bool colormap )
+{
+    glUseProgram( g_program );
+    glUniform1f( g_uBins, (float)bins );
+    glUniform1f( g_uRadius, radius );
+    glUniform1i( g_uUseMap, colormap );
+    glUniform1f( g_uSize, (float)COLOR_LUT_SIZE );
+    glUniform1i( g_uMap, 0 );
+    glBindTexture( GL_TEXTURE_1D, g_texture );
+
+    colormap_bins( bins );
+    glVertexAttribPointer( g_aBin, 1, GL_FLOAT, GL_FALSE, 0, 0 );
+    glEnableVertexAttribArray( g_aBin );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    glVertexAttribPointer( g_aSpectrum, 2, GL_FLOAT, GL_FALSE, sizeof(complex), spectrum );
+    glEnableVertexAttribArray( g_aSpectrum );
+
+    glDrawArrays( GL_LINE_LOOP, 0, (GLsizei)bins );
+
+    glDisableVertexAttribArray( g_aBin );
+    glDisableVertexAttribArray( g_aSpectrum );
+    glBindTexture( GL_TEXTURE_1D, 0 );
+    glUseProgram( 0 );
+}
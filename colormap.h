@@ -0,0 +1,27 @@
+//-----------------------------------------------------------------------------
+// name: colormap.h
+// desc: draw spectrum rings on the GPU with a 1D-texture colormap
+//
+//   the ring geometry and the colors are computed in a small GLSL
+//   program: each vertex is just a bin index (a static buffer) and that
+//   bin's (re, im), read straight from the spectrum, and magnitudes are
+//   colored by sampling a 1D texture built from colorSpectrum().  needs
+//   OpenGL 2.0; callers fall back to immediate mode without it.
+//-----------------------------------------------------------------------------
+#ifndef __COLORMAP_H__
+#define __COLORMAP_H__
+
+#include "chuck_fft.h"
+
+
+// compile the program and build the texture (needs a current context);
+// false if OpenGL 2.0 is not available
+bool colormap_init();
+// true once colormap_init() succeeded
+bool colormap_ready();
+// draw one ring of `bins` bins at `radius`, displaced by magnitude;
+// colored by magnitude if `colormap`, else with the current color
+void colormap_ring( const complex * spectrum, long bins, float radius, bool colormap );
+
+
+#endif
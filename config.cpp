@@ -0,0 +1,443 @@
+//-----------------------------------------------------------------------------
+// name: config.cpp
+// desc: stream and analysis settings from the command line or a file
+//-----------------------------------------------------------------------------
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+
+// api names, in RtAudio::Api order
+static const char * g_apiNames[] =
+{ "default", "alsa", "oss", "jack", "core", "asio", "ds", "dummy" };
+
+// keys that take no value on the command line
+static const char * g_configFlags[] =
+{ "minimize-latency", "realtime", "lock-memory", "alsa-poll", "monitor", NULL };
+
+// keys that take one
+static const char * g_configKeys[] =
+{
+    "srate", "frames", "periods", "channels", "device", "input-device",
+    "output-device", "api", "priority", "fft-size", "bands",
+    "band-count", "cqt-fmin", "cqt-octaves", "sdft", "smooth-rings",
+    "smooth-spectrogram", "fft-precision", "sched", "cpu-affinity",
+    "wakeup-frames", NULL
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: config_defaults()
+// desc: what sound-sphere always did
+//-----------------------------------------------------------------------------
+void config_defaults( Config * cfg )
+{
+    memset( cfg, 0, sizeof(Config) );
+    cfg->sampleRate = CONFIG_SRATE;
+    cfg->bufferFrames = CONFIG_FRAMES;
+    cfg->channels = CONFIG_CHANNELS;
+    cfg->inputDevice = -1;
+    cfg->outputDevice = -1;
+    cfg->api = RtAudio::UNSPECIFIED;
+    cfg->fftPrecision = FFT_PRECISION_MIXED;
+    cfg->bands = BANDS_NONE;
+    cfg->bandCount = CONFIG_BAND_COUNT;
+    cfg->cqtFmin = CQT_FMIN;
+    cfg->cqtOctaves = CQT_OCTAVES;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_in()
+// desc: is key in a NULL-terminated list
+//-----------------------------------------------------------------------------
+static bool config_in( const char * key, const char ** list )
+{
+    for( ; *list; list++ )
+        if( !strcmp( key, *list ) ) return true;
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_uint()
+// desc: parse a whole unsigned number
+//-----------------------------------------------------------------------------
+static bool config_uint( const char * value, unsigned int * out )
+{
+    char * end = NULL;
+    if( !value || !isdigit( (unsigned char)*value ) ) return false;
+    unsigned long n = strtoul( value, &end, 10 );
+    if( *end || n > 0xffffffffUL ) return false;
+    *out = (unsigned int)n;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_bool()
+// desc: yes/no, true/false, on/off, 1/0; no value means yes
+//-----------------------------------------------------------------------------
+static bool config_bool( const char * value, bool * out )
+{
+    if( !value || !*value || !strcmp( value, "yes" ) || !strcmp( value, "true" ) ||
+        !strcmp( value, "on" ) || !strcmp( value, "1" ) )
+        *out = true;
+    else if( !strcmp( value, "no" ) || !strcmp( value, "false" ) ||
+             !strcmp( value, "off" ) || !strcmp( value, "0" ) )
+        *out = false;
+    else
+        return false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_device_spec()
+// desc: a number is a device id, anything else part of a device name
+//-----------------------------------------------------------------------------
+static bool config_device_spec( const char * value, int * id, char * name )
+{
+    unsigned int n;
+    if( !value || !*value ) return false;
+    if( config_uint( value, &n ) )
+    {
+        *id = (int)n;
+        name[0] = '\0';
+    }
+    else
+    {
+        if( strlen( value ) >= CONFIG_NAME_SIZE ) return false;
+        strcpy( name, value );
+        *id = -1;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_float()
+// desc: parse a whole number, decimals allowed
+//-----------------------------------------------------------------------------
+static bool config_float( const char * value, float * out )
+{
+    char * end = NULL;
+    if( !value || !*value ) return false;
+    double x = strtod( value, &end );
+    if( *end ) return false;
+    *out = (float)x;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_cpus()
+// desc: cpu list, "2,3" or "0-3", as a mask (cpus 0 to 63)
+//-----------------------------------------------------------------------------
+static bool config_cpus( const char * value, unsigned long long * out )
+{
+    unsigned long long mask = 0;
+    const char * s = value;
+    if( !s || !*s ) return false;
+
+    for( ;; )
+    {
+        char * end = NULL;
+        if( !isdigit( (unsigned char)*s ) ) return false;
+        unsigned long first = strtoul( s, &end, 10 ), last = first;
+        if( *end == '-' )
+        {
+            s = end + 1;
+            if( !isdigit( (unsigned char)*s ) ) return false;
+            last = strtoul( s, &end, 10 );
+        }
+        if( last < first || last > 63 ) return false;
+        for( unsigned long c = first; c <= last; c++ )
+            mask |= 1ULL << c;
+        if( !*end ) break;
+        if( *end != ',' ) return false;
+        s = end + 1;
+    }
+
+    *out = mask;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_set()
+// desc: validate and store one setting
+//-----------------------------------------------------------------------------
+int config_set( Config * cfg, const char * key, const char * value )
+{
+    unsigned int n = 0;
+    bool ok = true;
+
+    if( !strcmp( key, "srate" ) )
+        ok = config_uint( value, &n ) && n > 0 && ( cfg->sampleRate = n );
+    else if( !strcmp( key, "frames" ) )
+        ok = config_uint( value, &n ) && n > 0 && ( cfg->bufferFrames = n );
+    else if( !strcmp( key, "periods" ) )
+        ok = config_uint( value, &cfg->periods );
+    else if( !strcmp( key, "channels" ) )
+        ok = config_uint( value, &n ) && n > 0 && ( cfg->channels = n );
+    else if( !strcmp( key, "priority" ) )
+        ok = config_uint( value, &cfg->priority );
+    else if( !strcmp( key, "fft-size" ) )
+    {
+        // rfft() needs a power of two
+        ok = config_uint( value, &n ) && ( n == 0 || ( n >= 4 && !( n & ( n - 1 ) ) ) );
+        if( ok ) cfg->fftSize = n;
+    }
+    else if( !strcmp( key, "bands" ) )
+        ok = value && bands_scale( value, &cfg->bands );
+    else if( !strcmp( key, "band-count" ) )
+        ok = config_uint( value, &n ) && n > 0 && ( cfg->bandCount = n );
+    else if( !strcmp( key, "cqt-fmin" ) )
+        ok = config_float( value, &cfg->cqtFmin ) && cfg->cqtFmin > 0;
+    else if( !strcmp( key, "cqt-octaves" ) )
+        ok = config_uint( value, &n ) && n > 0 && ( cfg->cqtOctaves = n );
+    else if( !strcmp( key, "sdft" ) )
+    {
+        unsigned int bins[SDFT_MAX_BINS];
+        ok = value && strlen( value ) < CONFIG_NAME_SIZE && sdft_bins( value, bins, SDFT_MAX_BINS ) > 0;
+        if( ok ) strcpy( cfg->sdftBins, value );
+    }
+    else if( !strcmp( key, "fft-precision" ) )
+        ok = fft_precision( value, &cfg->fftPrecision );
+    else if( !strcmp( key, "smooth-rings" ) )
+        ok = smooth_params( value, &cfg->smoothRings );
+    else if( !strcmp( key, "smooth-spectrogram" ) )
+        ok = smooth_params( value, &cfg->smoothSpectrogram );
+    else if( !strcmp( key, "sched" ) )
+    {
+        ok = value && ( !strcmp( value, "rr" ) || !strcmp( value, "fifo" ) );
+        if( ok ) cfg->fifo = !strcmp( value, "fifo" );
+    }
+    else if( !strcmp( key, "cpu-affinity" ) )
+        ok = config_cpus( value, &cfg->cpuAffinity );
+    else if( !strcmp( key, "api" ) )
+    {
+        ok = false;
+        for( unsigned int i = 0; value && i < sizeof(g_apiNames) / sizeof(g_apiNames[0]); i++ )
+        {
+            if( !strcmp( value, g_apiNames[i] ) )
+            {
+                cfg->api = (RtAudio::Api)i;
+                ok = true;
+            }
+        }
+    }
+    else if( !strcmp( key, "device" ) )
+        ok = config_device_spec( value, &cfg->inputDevice, cfg->inputName ) &&
+             config_device_spec( value, &cfg->outputDevice, cfg->outputName );
+    else if( !strcmp( key, "input-device" ) )
+        ok = config_device_spec( value, &cfg->inputDevice, cfg->inputName );
+    else if( !strcmp( key, "output-device" ) )
+        ok = config_device_spec( value, &cfg->outputDevice, cfg->outputName );
+    else if( !strcmp( key, "minimize-latency" ) )
+        ok = config_bool( value, &cfg->minimizeLatency );
+    else if( !strcmp( key, "realtime" ) )
+        ok = config_bool( value, &cfg->realtime );
+    else if( !strcmp( key, "lock-memory" ) )
+        ok = config_bool( value, &cfg->lockMemory );
+    else if( !strcmp( key, "alsa-poll" ) )
+        ok = config_bool( value, &cfg->alsaPoll );
+    else if( !strcmp( key, "wakeup-frames" ) )
+        ok = config_uint( value, &cfg->wakeupFrames );
+    else if( !strcmp( key, "monitor" ) )
+        ok = config_bool( value, &cfg->monitor );
+    else
+        return 0;
+
+    if( !ok )
+    {
+        fprintf( stderr, "[sound-sphere]: bad value for %s: %s\n", key, value ? value : "(none)" );
+        return -1;
+    }
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_trim()
+// desc: strip leading and trailing blanks in place
+//-----------------------------------------------------------------------------
+static char * config_trim( char * s )
+{
+    while( isspace( (unsigned char)*s ) ) s++;
+    char * end = s + strlen( s );
+    while( end > s && isspace( (unsigned char)end[-1] ) ) *--end = '\0';
+    return s;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_load()
+// desc: `key value` or `key = value` per line
+//-----------------------------------------------------------------------------
+bool config_load( Config * cfg, const char * path )
+{
+    FILE * file = fopen( path, "r" );
+    if( !file )
+    {
+        fprintf( stderr, "[sound-sphere]: cannot read config file %s\n", path );
+        return false;
+    }
+
+    char line[512];
+    int number = 0;
+    bool ok = true;
+    while( ok && fgets( line, sizeof(line), file ) )
+    {
+        number++;
+        char * hash = strchr( line, '#' );
+        if( hash ) *hash = '\0';
+        char * key = config_trim( line );
+        if( !*key ) continue;
+
+        // key ends at the first blank or '='
+        char * value = key + strcspn( key, " \t=" );
+        if( *value )
+        {
+            *value++ = '\0';
+            value = config_trim( value );
+            if( *value == '=' ) value = config_trim( value + 1 );
+        }
+
+        int result = config_set( cfg, key, value );
+        if( result <= 0 )
+        {
+            if( result == 0 )
+                fprintf( stderr, "[sound-sphere]: unknown setting %s\n", key );
+            fprintf( stderr, "[sound-sphere]: in %s, line %d\n", path, number );
+            ok = false;
+        }
+    }
+
+    fclose( file );
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_args()
+// desc: --key value, --flag, or --config file
+//-----------------------------------------------------------------------------
+int config_args( Config * cfg, int argc, char ** argv, int * i )
+{
+    const char * arg = argv[*i];
+    if( strncmp( arg, "--", 2 ) ) return 0;
+    const char * key = arg + 2;
+
+    if( config_in( key, g_configFlags ) )
+        return config_set( cfg, key, NULL );
+
+    bool isFile = !strcmp( key, "config" );
+    if( !isFile && !config_in( key, g_configKeys ) ) return 0;
+    if( *i + 1 >= argc )
+    {
+        fprintf( stderr, "[sound-sphere]: %s needs a value\n", arg );
+        return -1;
+    }
+
+    const char * value = argv[++*i];
+    if( isFile )
+        return config_load( cfg, value ) ? 1 : -1;
+    return config_set( cfg, key, value );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: config_device()
+// desc: first device whose name contains the given text and has channels
+//       in that direction, else the given id, else the default
+//-----------------------------------------------------------------------------
+int config_device( RtAudio & audio, const Config * cfg, bool input )
+{
+    const char * name = input ? cfg->inputName : cfg->outputName;
+    int id = input ? cfg->inputDevice : cfg->outputDevice;
+    unsigned int count = audio.getDeviceCount();
+
+    if( name[0] )
+    {
+        for( unsigned int d = 0; d < count; d++ )
+        {
+            RtAudio::DeviceInfo info;
+            try { info = audio.getDeviceInfo( d ); }
+            catch( RtError & ) { continue; }
+            unsigned int channels = input ? info.inputChannels : info.outputChannels;
+            if( info.probed && channels > 0 && strstr( info.name.c_str(), name ) )
+                return (int)d;
+        }
+        fprintf( stderr, "[sound-sphere]: no %s device matching \"%s\"\n",
+                 input ? "input" : "output", name );
+        return -1;
+    }
+
+    if( id < 0 )
+        return (int)( input ? audio.getDefaultInputDevice() : audio.getDefaultOutputDevice() );
+    if( (unsigned int)id >= count )
+    {
+        fprintf( stderr, "[sound-sphere]: no device %d (%u found)\n", id, count );
+        return -1;
+    }
+    return id;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_fft_size()
+// desc: periods are whatever the user or the api chose
+//-----------------------------------------------------------------------------
+unsigned int config_fft_size( const Config * cfg, unsigned int period )
+{
+    if( cfg->fftSize ) return cfg->fftSize;
+    unsigned int n = 4;
+    while( n < period && n < 0x80000000u ) n <<= 1;
+    return n;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_options()
+// desc: translate to RtAudio stream options
+//-----------------------------------------------------------------------------
+void config_options( const Config * cfg, RtAudio::StreamOptions * options )
+{
+    if( cfg->minimizeLatency ) options->flags |= RTAUDIO_MINIMIZE_LATENCY;
+    if( cfg->realtime ) options->flags |= RTAUDIO_SCHEDULE_REALTIME;
+    if( cfg->fifo ) options->flags |= RTAUDIO_SCHEDULE_FIFO;
+    if( cfg->lockMemory ) options->flags |= RTAUDIO_LOCK_MEMORY;
+    // a wakeup interval only means something to the poll loop
+    if( cfg->alsaPoll || cfg->wakeupFrames ) options->flags |= RTAUDIO_ALSA_POLL;
+    options->numberOfBuffers = cfg->periods;
+    options->priority = cfg->priority;
+    options->cpuAffinity = cfg->cpuAffinity;
+    options->wakeupFrames = cfg->wakeupFrames;
+}
+
+//-----------------------------------------------------------------------------
+// name: config_list_devices()
+// desc: id, channels and name of every device
+//-----------------------------------------------------------------------------
+void config_list_devices( RtAudio & audio )
+{
+    unsigned int count = audio.getDeviceCount();
+    printf( "# %s: %u device(s)\n", config_api_name( audio.getCurrentApi() ), count );
+    printf( "# id   in  out  name\n" );
+    for( unsigned int d = 0; d < count; d++ )
+    {
+        RtAudio::DeviceInfo info;
+        try { info = audio.getDeviceInfo( d ); }
+        catch( RtError & ) { continue; }
+        if( !info.probed ) continue;
+        printf( "%4u %4u %4u  %s%s%s\n", d, info.inputChannels, info.outputChannels,
+                info.name.c_str(), info.isDefaultInput ? " [default in]" : "",
+                info.isDefaultOutput ? " [default out]" : "" );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: config_api_name()
+// desc: the name accepted by --api
+//-----------------------------------------------------------------------------
+const char * config_api_name( RtAudio::Api api )
+{
+    if( (unsigned int)api >= sizeof(g_apiNames) / sizeof(g_apiNames[0]) ) return "unknown";
+    return g_apiNames[api];
+}
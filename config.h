@@ -0,0 +1,105 @@
+//-----------------------------------------------------------------------------
+// name: config.h
+// desc: stream and analysis settings from the command line or a file
+//
+//   every setting is a long option (`--srate 48000`) and the same key
+//   in a config file (`srate 48000` or `srate = 48000`, `#` comments).
+//   `--config file` loads a file at that point of the command line, so
+//   later options override it.  devices are given by id or by part of
+//   their name.
+//-----------------------------------------------------------------------------
+#ifndef __CONFIG_H__
+#define __CONFIG_H__
+
+#include "RtAudio.h"
+#include "bands.h"
+#include "cqt.h"
+#include "sdft.h"
+#include "smooth.h"
+#include "fftplan.h"
+
+
+// defaults
+#define CONFIG_SRATE 44100
+#define CONFIG_FRAMES 512
+#define CONFIG_CHANNELS 1
+#define CONFIG_BAND_COUNT 128
+// longest device name accepted
+#define CONFIG_NAME_SIZE 128
+
+
+//-----------------------------------------------------------------------------
+// name: struct Config
+// desc: everything needed to open the stream and size the analysis
+//-----------------------------------------------------------------------------
+struct Config
+{
+    unsigned int sampleRate;
+    // period size in frames, and number of periods (0 = api default)
+    unsigned int bufferFrames;
+    unsigned int periods;
+    unsigned int channels;
+    // device ids (-1 = default) or name substrings (empty = use the id)
+    int inputDevice;
+    int outputDevice;
+    char inputName[CONFIG_NAME_SIZE];
+    char outputName[CONFIG_NAME_SIZE];
+    RtAudio::Api api;
+    // RTAUDIO_MINIMIZE_LATENCY, RTAUDIO_SCHEDULE_REALTIME, its priority
+    // and policy (SCHED_FIFO instead of SCHED_RR)
+    bool minimizeLatency;
+    bool realtime;
+    unsigned int priority;
+    bool fifo;
+    // callback thread cpus, bit n = cpu n (0 = any), and
+    // RTAUDIO_LOCK_MEMORY
+    unsigned long long cpuAffinity;
+    bool lockMemory;
+    // alsa: wait for the device in poll() (RTAUDIO_ALSA_POLL), plus a
+    // timer wakeup every wakeupFrames frames (0 = none)
+    bool alsaPoll;
+    unsigned int wakeupFrames;
+    // analysis window, power of two (0 = one period), and the precision
+    // its (and the cqt's) transforms run at
+    unsigned int fftSize;
+    FftPrecision fftPrecision;
+    // band scale (BANDS_NONE = plain bins) and number of bands
+    BandScale bands;
+    unsigned int bandCount;
+    // cqt: lowest bin, Hz, and octaves above it
+    float cqtFmin;
+    unsigned int cqtOctaves;
+    // sliding dft bins, "1-64,80" (empty = off)
+    char sdftBins[CONFIG_NAME_SIZE];
+    // attack / release / peak hold for the rings and the spectrogram
+    // (all zero = off)
+    SmoothParams smoothRings;
+    SmoothParams smoothSpectrogram;
+    // open the output too and pass the input through (else input-only)
+    bool monitor;
+};
+
+
+// fill in the defaults
+void config_defaults( Config * cfg );
+// set one key; 1 if set, 0 if not a config key, -1 if the value is bad
+int config_set( Config * cfg, const char * key, const char * value );
+// read a config file; false (after printing why) on any error
+bool config_load( Config * cfg, const char * path );
+// take the option at argv[*i] (and its value); same returns as config_set
+int config_args( Config * cfg, int argc, char ** argv, int * i );
+
+// resolve a device by name or id; -1 (after printing why) if not found
+int config_device( RtAudio & audio, const Config * cfg, bool input );
+// analysis window for a period: --fft-size, else the period rounded up to
+// a power of two (the fft needs one)
+unsigned int config_fft_size( const Config * cfg, unsigned int period );
+// stream flags, periods, priority and affinity
+void config_options( const Config * cfg, RtAudio::StreamOptions * options );
+// print the devices of the selected api
+void config_list_devices( RtAudio & audio );
+// api name, for messages
+const char * config_api_name( RtAudio::Api api );
+
+
+#endif
@@ -0,0 +1,139 @@
+//-----------------------------------------------------------------------------
+// name: cqt.cpp
+// desc: constant-Q transform with a sparse spectral kernel
+//-----------------------------------------------------------------------------
+#include "cqt.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: cqt_create()
+// desc: transform every atom once and keep the part of its spectrum above
+//       the threshold
+//-----------------------------------------------------------------------------
+Cqt * cqt_create( float fmin, unsigned int octaves, unsigned int binsPerOctave, unsigned int sampleRate )
+{
+    // the top bin's atom has to fit below Nyquist
+    unsigned int bins = octaves * binsPerOctave;
+    while( bins > 0 && fmin * pow( 2.0, bins / (double)binsPerOctave ) > sampleRate / 2.0 )
+        bins--;
+    if( bins == 0 || fmin <= 0 ) return NULL;
+
+    // same Q for every bin: one bin's bandwidth at its center
+    double Q = 1.0 / ( pow( 2.0, 1.0 / binsPerOctave ) - 1.0 );
+    unsigned int longest = (unsigned int)ceil( Q * sampleRate / fmin );
+    unsigned int N = 4;
+    while( N < longest ) N <<= 1;
+
+    std::vector<unsigned int> rowStart, firstBin;
+    std::vector<complex> kernel;
+    std::vector<float> center;
+    std::vector<float> atom( 2 * N ), window( longest );
+    rowStart.push_back( 0 );
+
+    for( unsigned int k = 0; k < bins; k++ )
+    {
+        double f = fmin * pow( 2.0, k / (double)binsPerOctave );
+        unsigned int Nk = (unsigned int)ceil( Q * sampleRate / f );
+        unsigned int offset = N - Nk;
+        center.push_back( (float)f );
+
+        // hann(N_k) / N_k * e^(+i w n), ending at the window's last sample
+        hanning( &window[0], Nk );
+        memset( &atom[0], 0, sizeof(float) * 2 * N );
+        for( unsigned int n = 0; n < Nk; n++ )
+        {
+            double phase = 2.0 * M_PI * f * n / sampleRate;
+            atom[2*(offset+n)] = (float)( window[n] * cos( phase ) / Nk );
+            atom[2*(offset+n)+1] = (float)( window[n] * sin( phase ) / Nk );
+        }
+
+        // cfft() sums with e^(+i), scaled by 1/2N; the dot product with
+        // rfft() bins needs the e^(-i) sum, which is bin N-j of this one
+        cfft( &atom[0], N, FFT_FORWARD );
+        const complex * spectrum = (const complex *)&atom[0];
+        std::vector<complex> row( N / 2 );
+        float peak = 0;
+        for( unsigned int j = 1; j < N / 2; j++ )
+        {
+            row[j].re = 2.0f * N * spectrum[N-j].re;
+            row[j].im = 2.0f * N * spectrum[N-j].im;
+            float mag = (float)cmp_abs( row[j] );
+            if( mag > peak ) peak = mag;
+        }
+
+        // the kept part is one run around f_k (bin 0 is DC + Nyquist)
+        unsigned int first = 1, last = N / 2 - 1;
+        while( first < last && cmp_abs( row[first] ) < CQT_THRESHOLD * peak ) first++;
+        while( last > first && cmp_abs( row[last] ) < CQT_THRESHOLD * peak ) last--;
+
+        firstBin.push_back( first );
+        kernel.insert( kernel.end(), row.begin() + first, row.begin() + last + 1 );
+        rowStart.push_back( (unsigned int)kernel.size() );
+    }
+
+    Cqt * cqt = new Cqt;
+    cqt->bins = bins;
+    cqt->binsPerOctave = binsPerOctave;
+    cqt->fftSize = N;
+    cqt->sampleRate = sampleRate;
+    cqt->fmin = fmin;
+    cqt->rowStart = new unsigned int[bins + 1];
+    cqt->firstBin = new unsigned int[bins];
+    cqt->kernel = new complex[kernel.size()];
+    cqt->center = new float[bins];
+    memcpy( cqt->rowStart, &rowStart[0], sizeof(unsigned int) * ( bins + 1 ) );
+    memcpy( cqt->firstBin, &firstBin[0], sizeof(unsigned int) * bins );
+    memcpy( cqt->kernel, &kernel[0], sizeof(complex) * kernel.size() );
+    memcpy( cqt->center, &center[0], sizeof(float) * bins );
+    return cqt;
+}
+
+//-----------------------------------------------------------------------------
+// name: cqt_destroy()
+// desc: free the kernels
+//-----------------------------------------------------------------------------
+void cqt_destroy( Cqt * cqt )
+{
+    if( !cqt ) return;
+    delete [] cqt->rowStart;
+    delete [] cqt->firstBin;
+    delete [] cqt->kernel;
+    delete [] cqt->center;
+    delete cqt;
+}
+
+//-----------------------------------------------------------------------------
+// name: cqt_apply()
+// desc: one complex dot product per bin over its contiguous run; two
+//       accumulators per part so the adds don't serialize
+//-----------------------------------------------------------------------------
+void cqt_apply( const Cqt * cqt, const complex * spectrum, complex * out )
+{
+    for( unsigned int k = 0; k < cqt->bins; k++ )
+    {
+        const complex * w = cqt->kernel + cqt->rowStart[k];
+        const complex * x = spectrum + cqt->firstBin[k];
+        unsigned int n = cqt->rowStart[k + 1] - cqt->rowStart[k];
+        float re0 = 0, im0 = 0, re1 = 0, im1 = 0;
+        unsigned int j = 0;
+        for( ; j + 2 <= n; j += 2 )
+        {
+            re0 += x[j].re * w[j].re - x[j].im * w[j].im;
+            im0 += x[j].re * w[j].im + x[j].im * w[j].re;
+            re1 += x[j+1].re * w[j+1].re - x[j+1].im * w[j+1].im;
+            im1 += x[j+1].re * w[j+1].im + x[j+1].im * w[j+1].re;
+        }
+        for( ; j < n; j++ )
+        {
+            re0 += x[j].re * w[j].re - x[j].im * w[j].im;
+            im0 += x[j].re * w[j].im + x[j].im * w[j].re;
+        }
+        out[k].re = re0 + re1;
+        out[k].im = im0 + im1;
+    }
+}
@@ -0,0 +1,60 @@
+//-----------------------------------------------------------------------------
+// name: cqt.h
+// desc: constant-Q transform with a sparse spectral kernel
+//
+//   bin k is centered on fmin * 2^(k / binsPerOctave) and analyzes a
+//   hann-windowed complex exponential N_k = Q * sampleRate / f_k samples
+//   long, so low bins get long windows and high bins short ones.  rather
+//   than correlating with every atom in time, each atom is transformed
+//   once (Brown & Puckette): its spectrum is concentrated around f_k, so
+//   after dropping the near-zero part a transform is one rfft() of the
+//   longest window and a short complex dot product per bin.  atoms end
+//   at the newest sample, so high notes see the most recent input.
+//-----------------------------------------------------------------------------
+#ifndef __CQT_H__
+#define __CQT_H__
+
+#include "chuck_fft.h"
+
+
+// C1, the lowest note by default
+#define CQT_FMIN 32.7032f
+#define CQT_OCTAVES 8
+// one bin per semitone
+#define CQT_BINS_PER_OCTAVE 12
+// kernel values below this fraction of each kernel's peak are dropped
+#define CQT_THRESHOLD 0.005f
+
+
+//-----------------------------------------------------------------------------
+// name: struct Cqt
+// desc: sparse kernels, row k = kernel[rowStart[k] .. rowStart[k+1]) on
+//       rfft bins firstBin[k] ...
+//-----------------------------------------------------------------------------
+struct Cqt
+{
+    unsigned int bins;
+    unsigned int binsPerOctave;
+    // window (and rfft) length in samples, a power of two
+    unsigned int fftSize;
+    unsigned int sampleRate;
+    float fmin;
+    unsigned int * rowStart;
+    unsigned int * firstBin;
+    complex * kernel;
+    // bin centers, Hz
+    float * center;
+};
+
+
+// kernels for `octaves` octaves from fmin (fewer if they would pass
+// Nyquist); NULL if not even one fits
+Cqt * cqt_create( float fmin, unsigned int octaves, unsigned int binsPerOctave, unsigned int sampleRate );
+void cqt_destroy( Cqt * cqt );
+// out[k] for k < bins from the rfft() of the newest fftSize samples (not
+// windowed); a sine at a bin's center gives the same |X| as the peak
+// of the hann-windowed rfft() everything else draws
+void cqt_apply( const Cqt * cqt, const complex * spectrum, complex * out );
+
+
+#endif
@@ -0,0 +1,128 @@
+//-----------------------------------------------------------------------------
+// name: descriptors.cpp
+// desc: per-hop spectral descriptors in one fused pass
+//-----------------------------------------------------------------------------
+#include "descriptors.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+
+// added to every power before its log, so silence reads as flat
+#define DESCRIPTORS_FLOOR 1e-12f
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: descriptors_log2()
+// desc: log2 of a positive normal float: exponent bits plus a degree-5
+//       fit of log2 on the mantissa (|error| < 3e-5)
+//-----------------------------------------------------------------------------
+static inline float descriptors_log2( float x )
+{
+    uint32_t bits;
+    memcpy( &bits, &x, sizeof(bits) );
+    float e = (float)( (int32_t)( bits >> 23 ) - 127 );
+    bits = ( bits & 0x007fffff ) | 0x3f800000;
+    float t;
+    memcpy( &t, &bits, sizeof(t) );
+    t -= 1.0f;
+    return e + t * ( 1.4418255f + t * ( -0.70867891f + t * ( 0.41541119f +
+               t * ( -0.19440832f + t * 0.045878950f ) ) ) );
+}
+
+//-----------------------------------------------------------------------------
+// name: descriptors_compute()
+// desc: the fused pass over bins 1..bins-1 (bin 0 packs DC and Nyquist,
+//       which only count towards rms and peak), then the rolloff search
+//-----------------------------------------------------------------------------
+void descriptors_compute( const complex * spectrum, unsigned int bins, float binHz, float windowPower,
+                       float * prev, float * blocks, Descriptors * out )
+{
+    const unsigned int L = DESCRIPTORS_LANES;
+    float peak[L], energy[L], sum[L], weighted[L], logs[L], flux[L];
+    for( unsigned int j = 0; j < L; j++ )
+        peak[j] = energy[j] = sum[j] = weighted[j] = logs[j] = flux[j] = 0.0f;
+
+    unsigned int blockCount = bins > 1 ? ( bins - 1 ) / L : 0;
+    for( unsigned int b = 0; b < blockCount; b++ )
+    {
+        const complex * x = spectrum + 1 + b * L;
+        float * last = prev + 1 + b * L;
+        float base = (float)( 1 + b * L );
+        float power[L];
+        for( unsigned int j = 0; j < L; j++ )
+        {
+            float p = x[j].re * x[j].re + x[j].im * x[j].im;
+            float m = sqrtf( p );
+            float v = descriptors_log2( 1.0f + DESCRIPTORS_COMPRESSION * m );
+            float d = v - last[j];
+            last[j] = v;
+            power[j] = p;
+            peak[j] = m > peak[j] ? m : peak[j];
+            energy[j] += p;
+            sum[j] += m;
+            weighted[j] += ( base + j ) * m;
+            logs[j] += descriptors_log2( p + DESCRIPTORS_FLOOR );
+            flux[j] += d > 0.0f ? d : 0.0f;
+        }
+        float e = 0.0f;
+        for( unsigned int j = 0; j < L; j++ )
+            e += power[j];
+        blocks[b] = e;
+    }
+
+    // the bins that don't fill a block, into lane 0
+    float tail = 0.0f;
+    for( unsigned int k = 1 + blockCount * L; k < bins; k++ )
+    {
+        float p = spectrum[k].re * spectrum[k].re + spectrum[k].im * spectrum[k].im;
+        float m = sqrtf( p );
+        float v = descriptors_log2( 1.0f + DESCRIPTORS_COMPRESSION * m );
+        float d = v - prev[k];
+        prev[k] = v;
+        peak[0] = m > peak[0] ? m : peak[0];
+        energy[0] += p;
+        sum[0] += m;
+        weighted[0] += k * m;
+        logs[0] += descriptors_log2( p + DESCRIPTORS_FLOOR );
+        flux[0] += d > 0.0f ? d : 0.0f;
+        tail += p;
+    }
+    blocks[blockCount] = tail;
+
+    float dc = fabsf( spectrum[0].re ), nyquist = fabsf( spectrum[0].im );
+    float top = dc > nyquist ? dc : nyquist;
+    float E = 0.0f, S = 0.0f, W = 0.0f, G = 0.0f, F = 0.0f;
+    for( unsigned int j = 0; j < L; j++ )
+    {
+        top = peak[j] > top ? peak[j] : top;
+        E += energy[j];
+        S += sum[j];
+        W += weighted[j];
+        G += logs[j];
+        F += flux[j];
+    }
+    unsigned int n = bins > 1 ? bins - 1 : 1;
+
+    // the two halves of the spectrum, DC and Nyquist once
+    out->rms = sqrtf( ( dc * dc + nyquist * nyquist + 2.0f * E ) / windowPower );
+    out->peak = top;
+    out->centroid = S > 0.0f ? binHz * W / S : 0.0f;
+    out->flatness = exp2f( G / n ) / ( E / n + DESCRIPTORS_FLOOR );
+    out->flux = 0.69314718f * F;
+
+    // rolloff: whole blocks, then bins within the block that crosses
+    float target = DESCRIPTORS_ROLLOFF * E, acc = 0.0f;
+    unsigned int b = 0;
+    while( b < blockCount && acc + blocks[b] < target )
+        acc += blocks[b++];
+    unsigned int k = 1 + b * L;
+    for( ; k + 1 < bins; k++ )
+    {
+        acc += spectrum[k].re * spectrum[k].re + spectrum[k].im * spectrum[k].im;
+        if( acc >= target ) break;
+    }
+    out->rolloff = E > 0.0f ? k * binHz : 0.0f;
+}
@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+// name: descriptors.h
+// desc: per-hop spectral descriptors in one fused pass
+//
+//   rms, peak, centroid, rolloff, flatness and flux all come out of a
+//   single walk over the spectrum.  the loop keeps DESCRIPTORS_LANES partial
+//   results of everything and has no branches or library calls (logs are
+//   a bit trick plus a polynomial), so the compiler vectorizes it across
+//   bins.  rolloff needs the total energy before it can look for 85% of
+//   it; the pass stores each block's energy so the search afterwards only
+//   walks blocks and then one block's bins.
+//-----------------------------------------------------------------------------
+#ifndef __DESCRIPTORS_H__
+#define __DESCRIPTORS_H__
+
+#include "chuck_fft.h"
+
+
+// partial sums kept per pass (one vector's worth of floats, or two)
+#define DESCRIPTORS_LANES 8
+// rolloff: the frequency below which this much of the energy lies
+#define DESCRIPTORS_ROLLOFF 0.85f
+// flux is taken on log(1 + c |X|)
+#define DESCRIPTORS_COMPRESSION 100.0f
+
+
+//-----------------------------------------------------------------------------
+// name: struct Descriptors
+// desc: one channel's descriptors for one hop (plain floats, in this order
+//       in the shared-memory feed too)
+//-----------------------------------------------------------------------------
+struct Descriptors
+{
+    // of the input before windowing, from the spectrum (parseval)
+    float rms;
+    // largest |X|
+    float peak;
+    // magnitude-weighted mean frequency, and the rolloff frequency, Hz
+    float centroid;
+    float rolloff;
+    // geometric over arithmetic mean power: ~1 for noise, ~0 for tones
+    float flatness;
+    // summed increase of log(1 + c |X|) since the previous hop
+    float flux;
+};
+
+
+// scratch for descriptors_compute(): floats per `blocks` argument
+#define DESCRIPTORS_BLOCKS( bins ) ( ( bins ) / DESCRIPTORS_LANES + 1 )
+
+// descriptors of one rfft() spectrum of `bins` bins, binHz apart, made
+// with a window of mean square windowPower; prev holds the last hop's
+// compressed magnitudes [bins] and is updated
+void descriptors_compute( const complex * spectrum, unsigned int bins, float binHz, float windowPower,
+                       float * prev, float * blocks, Descriptors * out );
+
+
+#endif
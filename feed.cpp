@@ -0,0 +1,215 @@
+//-----------------------------------------------------------------------------
+// name: feed.cpp
+// desc: zero-copy magnitude spectrum feed in POSIX shared memory
+//-----------------------------------------------------------------------------
+#include "feed.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+
+// cache line
+#define FEED_ALIGN 64
+#define FEED_ROUND(x) ( ((x) + FEED_ALIGN - 1) & ~(size_t)(FEED_ALIGN - 1) )
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: feed_bytes()
+// desc: total size of a mapped segment
+//-----------------------------------------------------------------------------
+static size_t feed_bytes( const FeedHeader * h )
+{
+    return (size_t)h->headerSize + (size_t)h->slotSize * h->slots;
+}
+
+//-----------------------------------------------------------------------------
+// name: feed_slot_at()
+// desc: writable slot by index
+//-----------------------------------------------------------------------------
+static inline FeedSlot * feed_slot_at( FeedHeader * h, uint64_t frame )
+{
+    return (FeedSlot *)( (char *)h + h->headerSize + (size_t)h->slotSize * (frame % h->slots) );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: feed_create()
+// desc: size, map and prefault the segment so the writer never page-faults
+//-----------------------------------------------------------------------------
+FeedHeader * feed_create( const char * name, unsigned int fftSize, unsigned int hop,
+                          unsigned int sampleRate, unsigned int channels, unsigned int slots )
+{
+    unsigned int bins = fftSize / 2 + 1;
+    size_t headerSize = FEED_ROUND( sizeof(FeedHeader) );
+    size_t slotSize = FEED_ROUND( sizeof(FeedSlot) + sizeof(float) * ( bins + FEED_DESCRIPTORS ) * channels );
+    size_t bytes = headerSize + slotSize * slots;
+
+    int fd = shm_open( name, O_RDWR | O_CREAT, 0644 );
+    if( fd < 0 ) return NULL;
+    if( ftruncate( fd, bytes ) < 0 )
+    {
+        close( fd );
+        return NULL;
+    }
+    void * p = mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( p == MAP_FAILED ) return NULL;
+
+    // touch every page now
+    memset( p, 0, bytes );
+
+    FeedHeader * h = (FeedHeader *)p;
+    h->version = FEED_VERSION;
+    h->headerSize = (uint32_t)headerSize;
+    h->slotSize = (uint32_t)slotSize;
+    h->slots = slots;
+    h->fftSize = fftSize;
+    h->hop = hop;
+    h->sampleRate = sampleRate;
+    h->bins = bins;
+    h->channels = channels;
+    h->pid = (uint32_t)getpid();
+    h->descriptors = FEED_DESCRIPTORS;
+    h->written.store( 0, std::memory_order_relaxed );
+    // magic last: readers ignore the segment until it is stamped
+    std::atomic_thread_fence( std::memory_order_release );
+    h->magic = FEED_MAGIC;
+
+    return h;
+}
+
+//-----------------------------------------------------------------------------
+// name: feed_destroy()
+// desc: unmap and unlink; mapped readers keep their view until they unmap
+//-----------------------------------------------------------------------------
+void feed_destroy( FeedHeader * h, const char * name )
+{
+    if( !h ) return;
+    munmap( (void *)h, feed_bytes( h ) );
+    shm_unlink( name );
+}
+
+//-----------------------------------------------------------------------------
+// name: feed_begin()
+// desc: mark the next slot as being written
+//-----------------------------------------------------------------------------
+float * feed_begin( FeedHeader * h, double streamTime )
+{
+    uint64_t frame = h->written.load( std::memory_order_relaxed );
+    FeedSlot * slot = feed_slot_at( h, frame );
+
+    slot->seq.store( 2 * frame + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    slot->streamTime = streamTime;
+
+    return (float *)( slot + 1 );
+}
+
+//-----------------------------------------------------------------------------
+// name: feed_end()
+// desc: mark the slot complete and advertise it
+//-----------------------------------------------------------------------------
+void feed_end( FeedHeader * h )
+{
+    uint64_t frame = h->written.load( std::memory_order_relaxed );
+    FeedSlot * slot = feed_slot_at( h, frame );
+
+    slot->seq.store( 2 * frame + 2, std::memory_order_release );
+    h->written.store( frame + 1, std::memory_order_release );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: feed_open()
+// desc: map header first to learn the size, then the whole segment
+//-----------------------------------------------------------------------------
+const FeedHeader * feed_open( const char * name )
+{
+    int fd = shm_open( name, O_RDONLY, 0 );
+    if( fd < 0 ) return NULL;
+
+    struct stat st;
+    if( fstat( fd, &st ) < 0 || st.st_size < (off_t)sizeof(FeedHeader) )
+    {
+        close( fd );
+        return NULL;
+    }
+
+    void * p = mmap( NULL, sizeof(FeedHeader), PROT_READ, MAP_SHARED, fd, 0 );
+    if( p == MAP_FAILED )
+    {
+        close( fd );
+        return NULL;
+    }
+
+    const FeedHeader * h = (const FeedHeader *)p;
+    size_t bytes = feed_bytes( h );
+    bool ok = h->magic == FEED_MAGIC && h->version == FEED_VERSION && (off_t)bytes <= st.st_size;
+    munmap( p, sizeof(FeedHeader) );
+    if( !ok )
+    {
+        close( fd );
+        return NULL;
+    }
+
+    // exactly feed_bytes(), so feed_close() unmaps what was mapped
+    p = mmap( NULL, bytes, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( p == MAP_FAILED ) return NULL;
+
+    return (const FeedHeader *)p;
+}
+
+//-----------------------------------------------------------------------------
+// name: feed_close()
+// desc: unmap
+//-----------------------------------------------------------------------------
+void feed_close( const FeedHeader * h )
+{
+    if( h ) munmap( (void *)h, feed_bytes( h ) );
+}
+
+//-----------------------------------------------------------------------------
+// name: feed_slot()
+// desc: slot for a frame number
+//-----------------------------------------------------------------------------
+const FeedSlot * feed_slot( const FeedHeader * h, uint64_t frame )
+{
+    return (const FeedSlot *)( (const char *)h + h->headerSize + (size_t)h->slotSize * (frame % h->slots) );
+}
+
+//-----------------------------------------------------------------------------
+// name: feed_data()
+// desc: magnitudes for one channel of a slot
+//-----------------------------------------------------------------------------
+const float * feed_data( const FeedHeader * h, const FeedSlot * slot, unsigned int channel )
+{
+    return (const float *)( slot + 1 ) + (size_t)channel * h->bins;
+}
+
+//-----------------------------------------------------------------------------
+// name: feed_descriptors()
+// desc: descriptors for one channel of a slot
+//-----------------------------------------------------------------------------
+const float * feed_descriptors( const FeedHeader * h, const FeedSlot * slot, unsigned int channel )
+{
+    return (const float *)( slot + 1 ) + (size_t)h->channels * h->bins + (size_t)channel * h->descriptors;
+}
+
+//-----------------------------------------------------------------------------
+// name: feed_valid()
+// desc: seq check; the fence orders the caller's reads before the re-check
+//-----------------------------------------------------------------------------
+bool feed_valid( const FeedSlot * slot, uint64_t frame )
+{
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return slot->seq.load( std::memory_order_acquire ) == 2 * frame + 2;
+}
@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------
+// name: feed.h
+// desc: zero-copy magnitude spectrum feed in POSIX shared memory
+//
+//   the segment is a FeedHeader followed by a ring of slots; each slot is a
+//   FeedSlot followed by channels * bins floats (channel-major), then
+//   channels * descriptors floats (rms, peak, centroid, rolloff, flatness,
+//   flux per channel; see descriptors.h).  frame n
+//   lives in slot n % slots.  the writer marks a slot odd (2n+1) while it
+//   fills it and even (2n+2) when done, then bumps `written`.  readers map
+//   the segment read-only, use the floats in place and afterwards check
+//   that the slot still holds frame n; no locks, no copies, no limit on
+//   the number of readers.
+//-----------------------------------------------------------------------------
+#ifndef __FEED_H__
+#define __FEED_H__
+
+#include <atomic>
+#include <stdint.h>
+
+
+// default segment name
+#define FEED_SHM_NAME "/sound-sphere.spectrum"
+// 'SSSP'
+#define FEED_MAGIC 0x50535353
+// bump when the layout changes
+#define FEED_VERSION 2
+// default number of slots in the ring
+#define FEED_SLOTS 64
+// descriptor floats per channel
+#define FEED_DESCRIPTORS 6
+
+
+//-----------------------------------------------------------------------------
+// name: struct FeedHeader
+// desc: start of the segment, written once except for `written`
+//-----------------------------------------------------------------------------
+struct FeedHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    // byte offset of slot 0, and bytes per slot (both multiples of 64)
+    uint32_t headerSize;
+    uint32_t slotSize;
+    uint32_t slots;
+    // analysis parameters
+    uint32_t fftSize;
+    uint32_t hop;
+    uint32_t sampleRate;
+    // magnitudes per channel (fftSize/2 + 1: DC through Nyquist)
+    uint32_t bins;
+    uint32_t channels;
+    uint32_t pid;
+    // descriptor floats per channel, after all the magnitudes
+    uint32_t descriptors;
+    // number of frames published; the newest is written - 1
+    std::atomic<uint64_t> written;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct FeedSlot
+// desc: per-frame header, followed by the magnitudes
+//-----------------------------------------------------------------------------
+struct FeedSlot
+{
+    // 2n+1 while frame n is being written, 2n+2 once it is complete
+    std::atomic<uint64_t> seq;
+    // stream time of the buffer that completed the analysis window, seconds
+    double streamTime;
+};
+
+
+// writer: create the segment; NULL on failure
+FeedHeader * feed_create( const char * name, unsigned int fftSize, unsigned int hop,
+                          unsigned int sampleRate, unsigned int channels, unsigned int slots );
+// writer: unmap and remove
+void feed_destroy( FeedHeader * h, const char * name );
+// writer: start frame n = h->written; returns the magnitudes to fill (the
+// descriptors follow them)
+float * feed_begin( FeedHeader * h, double streamTime );
+// writer: publish the frame started by feed_begin()
+void feed_end( FeedHeader * h );
+
+// reader: map read-only; NULL on failure or version mismatch
+const FeedHeader * feed_open( const char * name );
+// reader: unmap
+void feed_close( const FeedHeader * h );
+// reader: slot holding frame n (which may since have been overwritten)
+const FeedSlot * feed_slot( const FeedHeader * h, uint64_t frame );
+// reader: magnitudes of a slot, channel c
+const float * feed_data( const FeedHeader * h, const FeedSlot * slot, unsigned int channel );
+// reader: descriptors of a slot, channel c
+const float * feed_descriptors( const FeedHeader * h, const FeedSlot * slot, unsigned int channel );
+// reader: true if the slot holds a complete frame n; check before and after use
+bool feed_valid( const FeedSlot * slot, uint64_t frame );
+
+
+#endif
@@ -0,0 +1,426 @@
+//-----------------------------------------------------------------------------
+// name: fftplan.cpp
+// desc: rfft() plans with a choice of precision
+//-----------------------------------------------------------------------------
+#include "fftplan.h"
+#include "chuck_fft.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+
+static const char * g_precisionNames[] = { "float", "mixed", "double" };
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: plan_cfft()
+// desc: cfft() with table twiddles: same bit reversal, butterflies and
+//       scaling, but each twiddle is looked up instead of carried along
+//       (and blocks run outermost, so each stays in cache)
+//-----------------------------------------------------------------------------
+template <typename Real>
+static void plan_cfft( Real * x, long NC, const Real * cs, const Real * sn, unsigned int forward )
+{
+    long ND = NC << 1, i, j, m, mmax, delta;
+    Real sign = forward ? 1 : -1;
+
+    for( i = j = 0; i < ND; i += 2, j += m )
+    {
+        if( j > i )
+        {
+            Real r = x[j], im = x[j+1];
+            x[j] = x[i]; x[j+1] = x[i+1];
+            x[i] = r; x[i+1] = im;
+        }
+        for( m = ND >> 1; m >= 2 && j >= m; m >>= 1 )
+            j -= m;
+    }
+
+    for( mmax = 2; mmax < ND; mmax = delta )
+    {
+        delta = mmax << 1;
+        // twiddle m/2 of this pass is e^(2 pi i (m/2) / mmax)
+        long stride = NC / mmax;
+        for( i = 0; i < ND; i += delta )
+            for( m = 0; m < mmax; m += 2 )
+            {
+                Real wr = cs[(m >> 1) * stride], wi = sign * sn[(m >> 1) * stride];
+                long a = i + m, b = a + mmax;
+                Real rtemp = wr * x[b] - wi * x[b+1];
+                Real itemp = wr * x[b+1] + wi * x[b];
+                x[b] = x[a] - rtemp;
+                x[b+1] = x[a+1] - itemp;
+                x[a] += rtemp;
+                x[a+1] += itemp;
+            }
+    }
+
+    Real scale = forward ? (Real)1 / ND : (Real)2;
+    for( i = 0; i < ND; i++ )
+        x[i] *= scale;
+}
+
+//-----------------------------------------------------------------------------
+// name: plan_rfft()
+// desc: rfft() with table twiddles for the complex passes and the split
+//-----------------------------------------------------------------------------
+template <typename Real>
+static void plan_rfft( Real * x, long N, const Real * cs, const Real * sn,
+                       const Real * splitCs, const Real * splitSn, unsigned int forward )
+{
+    Real c1 = 0.5, c2, h1r, h1i, h2r, h2i, wr, wi, xr, xi;
+    Real sign = forward ? 1 : -1;
+    long i, i1, i2, i3, i4, N2p1 = ( N << 1 ) + 1;
+
+    if( forward )
+    {
+        c2 = -0.5;
+        plan_cfft( x, N, cs, sn, forward );
+        xr = x[0];
+        xi = x[1];
+    }
+    else
+    {
+        c2 = 0.5;
+        xr = x[1];
+        xi = 0;
+        x[1] = 0;
+    }
+
+    for( i = 0; i <= N >> 1; i++ )
+    {
+        wr = splitCs[i];
+        wi = sign * splitSn[i];
+        i1 = i << 1;
+        i2 = i1 + 1;
+        i3 = N2p1 - i2;
+        i4 = i3 + 1;
+        if( i == 0 )
+        {
+            h1r =  c1 * ( x[i1] + xr );
+            h1i =  c1 * ( x[i2] - xi );
+            h2r = -c2 * ( x[i2] + xi );
+            h2i =  c2 * ( x[i1] - xr );
+            x[i1] =  h1r + wr * h2r - wi * h2i;
+            x[i2] =  h1i + wr * h2i + wi * h2r;
+            xr =  h1r - wr * h2r + wi * h2i;
+            xi = -h1i + wr * h2i + wi * h2r;
+        }
+        else
+        {
+            h1r =  c1 * ( x[i1] + x[i3] );
+            h1i =  c1 * ( x[i2] - x[i4] );
+            h2r = -c2 * ( x[i2] + x[i4] );
+            h2i =  c2 * ( x[i1] - x[i3] );
+            x[i1] =  h1r + wr * h2r - wi * h2i;
+            x[i2] =  h1i + wr * h2i + wi * h2r;
+            x[i3] =  h1r - wr * h2r + wi * h2i;
+            x[i4] = -h1i + wr * h2i + wi * h2r;
+        }
+    }
+
+    if( forward )
+        x[1] = xr;
+    else
+        plan_cfft( x, N, cs, sn, forward );
+}
+
+//-----------------------------------------------------------------------------
+// name: plan_cfft_batch()
+// desc: cfft_batch() with table twiddles: K signals element-major, each
+//       twiddle looked up once and applied to all of them
+//-----------------------------------------------------------------------------
+template <typename Real>
+static void plan_cfft_batch( Real * x, long NC, long K, const Real * cs, const Real * sn, unsigned int forward )
+{
+    long ND = NC << 1, i, j, k, m, mmax, delta;
+    Real sign = forward ? 1 : -1;
+
+    for( i = j = 0; i < ND; i += 2, j += m )
+    {
+        if( j > i )
+        {
+            Real * xi = x + i * K, * xj = x + j * K;
+            for( k = 0; k < 2 * K; k++ )
+            {
+                Real t = xj[k];
+                xj[k] = xi[k];
+                xi[k] = t;
+            }
+        }
+        for( m = ND >> 1; m >= 2 && j >= m; m >>= 1 )
+            j -= m;
+    }
+
+    for( mmax = 2; mmax < ND; mmax = delta )
+    {
+        delta = mmax << 1;
+        long stride = NC / mmax;
+        for( m = 0; m < mmax; m += 2 )
+        {
+            Real wr = cs[(m >> 1) * stride], wi = sign * sn[(m >> 1) * stride];
+            for( i = m; i < ND; i += delta )
+            {
+                Real * xi = x + i * K, * xj = x + ( i + mmax ) * K;
+                for( k = 0; k < K; k++ )
+                {
+                    Real rtemp = wr * xj[k] - wi * xj[K+k];
+                    Real itemp = wr * xj[K+k] + wi * xj[k];
+                    xj[k] = xi[k] - rtemp;
+                    xj[K+k] = xi[K+k] - itemp;
+                    xi[k] += rtemp;
+                    xi[K+k] += itemp;
+                }
+            }
+        }
+    }
+
+    Real scale = forward ? (Real)1 / ND : (Real)2;
+    for( i = 0; i < ND * K; i++ )
+        x[i] *= scale;
+}
+
+//-----------------------------------------------------------------------------
+// name: plan_rfft_batch()
+// desc: rfft_batch() with table twiddles
+//-----------------------------------------------------------------------------
+template <typename Real>
+static void plan_rfft_batch( Real * x, long N, long K, const Real * cs, const Real * sn,
+                             const Real * splitCs, const Real * splitSn, unsigned int forward )
+{
+    Real c1 = 0.5, c2, h1r, h1i, h2r, h2i, wr, wi, a, b;
+    Real sign = forward ? 1 : -1;
+    long i, k;
+
+    if( forward )
+    {
+        c2 = -0.5;
+        plan_cfft_batch( x, N, K, cs, sn, forward );
+    }
+    else
+        c2 = 0.5;
+
+    // i == 0: DC and Nyquist share x[0] and x[1] (w is 1 here)
+    for( k = 0; k < K; k++ )
+    {
+        a = x[k];
+        b = x[K+k];
+        x[k] = forward ? a + b : c1 * ( a + b );
+        x[K+k] = forward ? a - b : c2 * ( a - b );
+    }
+
+    for( i = 1; i <= N >> 1; i++ )
+    {
+        Real * x1 = x + ( i << 1 ) * K, * x2 = x1 + K;
+        Real * x3 = x + ( ( N << 1 ) - ( i << 1 ) ) * K, * x4 = x3 + K;
+        wr = splitCs[i];
+        wi = sign * splitSn[i];
+        for( k = 0; k < K; k++ )
+        {
+            h1r =  c1 * ( x1[k] + x3[k] );
+            h1i =  c1 * ( x2[k] - x4[k] );
+            h2r = -c2 * ( x2[k] + x4[k] );
+            h2i =  c2 * ( x1[k] - x3[k] );
+            x1[k] =  h1r + wr * h2r - wi * h2i;
+            x2[k] =  h1i + wr * h2i + wi * h2r;
+            x3[k] =  h1r - wr * h2r + wi * h2i;
+            x4[k] = -h1i + wr * h2i + wi * h2r;
+        }
+    }
+
+    if( !forward )
+        plan_cfft_batch( x, N, K, cs, sn, forward );
+}
+
+//-----------------------------------------------------------------------------
+// name: plan_tables()
+// desc: both twiddle tables for size N, in any precision
+//-----------------------------------------------------------------------------
+template <typename Real>
+static void plan_tables( long N, Real * cs, Real * sn, Real * splitCs, Real * splitSn )
+{
+    const long double pi = 3.14159265358979323846264338327950288L;
+    for( long t = 0; t < N / 2; t++ )
+    {
+        cs[t] = (Real)cosl( 2 * pi * t / N );
+        sn[t] = (Real)sinl( 2 * pi * t / N );
+    }
+    for( long t = 0; t <= N / 2; t++ )
+    {
+        splitCs[t] = (Real)cosl( pi * t / N );
+        splitSn[t] = (Real)sinl( pi * t / N );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: fft_plan_create()
+// desc: tables for the mixed and double precisions
+//-----------------------------------------------------------------------------
+FftPlan * fft_plan_create( long N, FftPrecision precision )
+{
+    if( N < 2 || ( N & ( N - 1 ) ) ) return NULL;
+
+    FftPlan * p = new FftPlan;
+    memset( p, 0, sizeof(FftPlan) );
+    p->N = N;
+    p->precision = precision;
+    if( precision == FFT_PRECISION_FLOAT ) return p;
+
+    p->cosd = new double[N / 2];
+    p->sind = new double[N / 2];
+    p->splitCosd = new double[N / 2 + 1];
+    p->splitSind = new double[N / 2 + 1];
+    plan_tables( N, p->cosd, p->sind, p->splitCosd, p->splitSind );
+    if( precision == FFT_PRECISION_MIXED )
+    {
+        p->cosf = new float[N / 2];
+        p->sinf = new float[N / 2];
+        p->splitCosf = new float[N / 2 + 1];
+        p->splitSinf = new float[N / 2 + 1];
+        for( long t = 0; t < N / 2; t++ )
+        {
+            p->cosf[t] = (float)p->cosd[t];
+            p->sinf[t] = (float)p->sind[t];
+        }
+        for( long t = 0; t <= N / 2; t++ )
+        {
+            p->splitCosf[t] = (float)p->splitCosd[t];
+            p->splitSinf[t] = (float)p->splitSind[t];
+        }
+    }
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+// name: fft_plan_destroy()
+// desc: free the tables
+//-----------------------------------------------------------------------------
+void fft_plan_destroy( FftPlan * p )
+{
+    if( !p ) return;
+    delete [] p->cosd;
+    delete [] p->sind;
+    delete [] p->splitCosd;
+    delete [] p->splitSind;
+    delete [] p->cosf;
+    delete [] p->sinf;
+    delete [] p->splitCosf;
+    delete [] p->splitSinf;
+    delete p;
+}
+
+//-----------------------------------------------------------------------------
+// name: fft_plan_rfft()
+// desc: dispatch on precision
+//-----------------------------------------------------------------------------
+void fft_plan_rfft( const FftPlan * p, float * x, double * scratch, unsigned int forward )
+{
+    long n = p->N << 1;
+
+    switch( p->precision )
+    {
+    case FFT_PRECISION_MIXED:
+        plan_rfft( x, p->N, p->cosf, p->sinf, p->splitCosf, p->splitSinf, forward );
+        break;
+    case FFT_PRECISION_DOUBLE:
+        for( long i = 0; i < n; i++ )
+            scratch[i] = x[i];
+        plan_rfft( scratch, p->N, p->cosd, p->sind, p->splitCosd, p->splitSind, forward );
+        for( long i = 0; i < n; i++ )
+            x[i] = (float)scratch[i];
+        break;
+    default:
+        rfft( x, p->N, forward );
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: fft_plan_rfft_batch()
+// desc: float and mixed only; double would need K signals of scratch
+//-----------------------------------------------------------------------------
+bool fft_plan_rfft_batch( const FftPlan * p, float * x, long K, unsigned int forward )
+{
+    switch( p->precision )
+    {
+    case FFT_PRECISION_FLOAT:
+        rfft_batch( x, p->N, K, forward );
+        return true;
+    case FFT_PRECISION_MIXED:
+        plan_rfft_batch( x, p->N, K, p->cosf, p->sinf, p->splitCosf, p->splitSinf, forward );
+        return true;
+    default:
+        return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: fft_precision()
+// desc: parse a precision name
+//-----------------------------------------------------------------------------
+bool fft_precision( const char * name, FftPrecision * out )
+{
+    for( int i = 0; i <= FFT_PRECISION_DOUBLE; i++ )
+        if( name && !strcmp( name, g_precisionNames[i] ) )
+        {
+            *out = (FftPrecision)i;
+            return true;
+        }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// name: fft_precision_name()
+// desc: for messages
+//-----------------------------------------------------------------------------
+const char * fft_precision_name( FftPrecision precision )
+{
+    return g_precisionNames[precision];
+}
+
+//-----------------------------------------------------------------------------
+// name: fft_plan_error()
+// desc: the same float noise through the plan and through long double
+//-----------------------------------------------------------------------------
+double fft_plan_error( const FftPlan * p )
+{
+    long N = p->N, n = N << 1;
+    float * x = new float[n];
+    double * scratch = new double[n];
+    long double * ref = new long double[n];
+    long double * cs = new long double[N / 2];
+    long double * sn = new long double[N / 2];
+    long double * splitCs = new long double[N / 2 + 1];
+    long double * splitSn = new long double[N / 2 + 1];
+
+    // deterministic, so runs compare
+    uint32_t seed = 22222;
+    for( long i = 0; i < n; i++ )
+    {
+        seed = seed * 1664525u + 1013904223u;
+        x[i] = (float)( seed / 2147483648.0 - 1.0 );
+        ref[i] = x[i];
+    }
+
+    plan_tables( N, cs, sn, splitCs, splitSn );
+    plan_rfft( ref, N, cs, sn, splitCs, splitSn, FFT_FORWARD );
+    fft_plan_rfft( p, x, scratch, FFT_FORWARD );
+
+    long double err = 0, level = 0;
+    for( long i = 0; i < n; i++ )
+    {
+        err += ( x[i] - ref[i] ) * ( x[i] - ref[i] );
+        level += ref[i] * ref[i];
+    }
+
+    delete [] x;
+    delete [] scratch;
+    delete [] ref;
+    delete [] cs;
+    delete [] sn;
+    delete [] splitCs;
+    delete [] splitSn;
+    return level > 0 ? (double)sqrtl( err / level ) : 0.0;
+}
@@ -0,0 +1,75 @@
+//-----------------------------------------------------------------------------
+// name: fftplan.h
+// desc: rfft() plans with a choice of precision
+//
+//   rfft() and cfft() build every twiddle factor with a float recurrence,
+//   w <- w + w * (e^(i theta) - 1), whose rounding error grows with the
+//   number of steps, so large transforms get a raised, uneven noise floor.
+//   a plan computes the twiddles once, in double, for one size:
+//
+//     FFT_PRECISION_FLOAT   rfft() as it always was
+//     FFT_PRECISION_MIXED   float data, twiddles from double-precision
+//                           tables (rounded once to float)
+//     FFT_PRECISION_DOUBLE  data converted to double, transformed with the
+//                           double tables, and rounded back
+//
+//   every precision takes and returns the same packed layout and scaling
+//   as rfft(), so callers switch by changing the plan.
+//-----------------------------------------------------------------------------
+#ifndef __FFTPLAN_H__
+#define __FFTPLAN_H__
+
+
+//-----------------------------------------------------------------------------
+// name: enum FftPrecision
+// desc: arithmetic used by a plan
+//-----------------------------------------------------------------------------
+enum FftPrecision
+{
+    FFT_PRECISION_FLOAT = 0,
+    FFT_PRECISION_MIXED,
+    FFT_PRECISION_DOUBLE
+};
+
+//-----------------------------------------------------------------------------
+// name: struct FftPlan
+// desc: twiddle tables for an N-point rfft() (2N reals); read-only once
+//       made, so threads can share one
+//-----------------------------------------------------------------------------
+struct FftPlan
+{
+    long N;
+    FftPrecision precision;
+    // e^(2 pi i t / N), t < N/2, for the complex passes, and
+    // e^(pi i t / N), t <= N/2, for the real-to-complex split
+    double * cosd;
+    double * sind;
+    double * splitCosd;
+    double * splitSind;
+    // the same, rounded to float (mixed)
+    float * cosf;
+    float * sinf;
+    float * splitCosf;
+    float * splitSinf;
+};
+
+
+// plan for rfft( x, N, ... ); N a power of two
+FftPlan * fft_plan_create( long N, FftPrecision precision );
+void fft_plan_destroy( FftPlan * p );
+// rfft( x, p->N, forward ) at the plan's precision; scratch holds 2N
+// doubles and is only used (and only needed) for FFT_PRECISION_DOUBLE
+void fft_plan_rfft( const FftPlan * p, float * x, double * scratch, unsigned int forward );
+// rfft_batch( x, p->N, K, forward ) at the plan's precision; false (and x
+// untouched) for FFT_PRECISION_DOUBLE, which goes signal by signal
+bool fft_plan_rfft_batch( const FftPlan * p, float * x, long K, unsigned int forward );
+
+// "float", "mixed" or "double"; false if it is none of them
+bool fft_precision( const char * name, FftPrecision * out );
+const char * fft_precision_name( FftPrecision precision );
+// rms error of the plan's forward transform of white noise, relative to
+// the spectrum's rms level, against the same transform in long double
+double fft_plan_error( const FftPlan * p );
+
+
+#endif
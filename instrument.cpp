@@ -0,0 +1,206 @@
+//-----------------------------------------------------------------------------
+// name: instrument.cpp
+// desc: lock-free real-time instrumentation for the audio callback
+//-----------------------------------------------------------------------------
+#include "instrument.h"
+#include "RtAudio.h"
+#include <time.h>
+#include <stdio.h>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: hist_bucket()
+// desc: bucket index of a value; values below 2*HIST_SUB are exact
+//-----------------------------------------------------------------------------
+static inline int hist_bucket( uint64_t value )
+{
+    if( value >= (1ULL << HIST_MAX_BITS) ) value = (1ULL << HIST_MAX_BITS) - 1;
+    if( value < 2 * HIST_SUB ) return (int)value;
+
+    int msb = 63 - __builtin_clzll( value );
+    int shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)( (value >> shift) - HIST_SUB );
+}
+
+//-----------------------------------------------------------------------------
+// name: hist_upper()
+// desc: largest value that falls into a bucket
+//-----------------------------------------------------------------------------
+static inline uint64_t hist_upper( int bucket )
+{
+    if( bucket < 2 * HIST_SUB ) return bucket;
+
+    int shift = bucket / HIST_SUB - 1;
+    uint64_t low = (uint64_t)( HIST_SUB + bucket % HIST_SUB ) << shift;
+    return low + (1ULL << shift) - 1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: hist_clear()
+// desc: zero a histogram
+//-----------------------------------------------------------------------------
+void hist_clear( Histogram * h )
+{
+    for( int i = 0; i < HIST_BUCKETS; i++ )
+        h->counts[i].store( 0, std::memory_order_relaxed );
+    h->total.store( 0, std::memory_order_relaxed );
+    h->sum.store( 0, std::memory_order_relaxed );
+    h->max.store( 0, std::memory_order_relaxed );
+}
+
+//-----------------------------------------------------------------------------
+// name: hist_record()
+// desc: single writer, so plain load/store instead of read-modify-write
+//-----------------------------------------------------------------------------
+void hist_record( Histogram * h, uint64_t value )
+{
+    std::atomic<uint32_t> & c = h->counts[hist_bucket( value )];
+    c.store( c.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    h->sum.store( h->sum.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+    if( value > h->max.load( std::memory_order_relaxed ) )
+        h->max.store( value, std::memory_order_relaxed );
+    // publish last so a reader never sees more total than counts
+    h->total.store( h->total.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+}
+
+//-----------------------------------------------------------------------------
+// name: hist_percentile()
+// desc: walk the buckets until p percent of the values are covered
+//-----------------------------------------------------------------------------
+uint64_t hist_percentile( const Histogram * h, double p )
+{
+    uint64_t total = h->total.load( std::memory_order_acquire );
+    if( total == 0 ) return 0;
+
+    uint64_t target = (uint64_t)( p / 100.0 * total + 0.5 );
+    if( target < 1 ) target = 1;
+    uint64_t seen = 0;
+    for( int i = 0; i < HIST_BUCKETS; i++ )
+    {
+        seen += h->counts[i].load( std::memory_order_relaxed );
+        if( seen >= target )
+        {
+            uint64_t upper = hist_upper( i );
+            uint64_t max = h->max.load( std::memory_order_relaxed );
+            return upper < max ? upper : max;
+        }
+    }
+
+    return h->max.load( std::memory_order_relaxed );
+}
+
+//-----------------------------------------------------------------------------
+// name: hist_mean()
+// desc: average value
+//-----------------------------------------------------------------------------
+double hist_mean( const Histogram * h )
+{
+    uint64_t total = h->total.load( std::memory_order_acquire );
+    return total ? (double)h->sum.load( std::memory_order_relaxed ) / total : 0.0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: inst_clear()
+// desc: zero all histograms and counters
+//-----------------------------------------------------------------------------
+void inst_clear( Instrument * inst )
+{
+    hist_clear( &inst->callback );
+    hist_clear( &inst->interval );
+    hist_clear( &inst->jitter );
+    hist_clear( &inst->latency );
+    inst->callbacks.store( 0 );
+    inst->overflows.store( 0 );
+    inst->underflows.store( 0 );
+    inst->lastStart = 0;
+}
+
+//-----------------------------------------------------------------------------
+// name: inst_now()
+// desc: monotonic time in ns (vDSO on Linux, no syscall)
+//-----------------------------------------------------------------------------
+uint64_t inst_now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//-----------------------------------------------------------------------------
+// name: inst_callback_begin()
+// desc: count xruns and record the time since the previous callback
+//-----------------------------------------------------------------------------
+uint64_t inst_callback_begin( Instrument * inst, unsigned int status, uint64_t periodNs )
+{
+    uint64_t start = inst_now();
+
+    if( status & RTAUDIO_INPUT_OVERFLOW )
+        inst->overflows.store( inst->overflows.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    if( status & RTAUDIO_OUTPUT_UNDERFLOW )
+        inst->underflows.store( inst->underflows.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+    if( inst->lastStart )
+    {
+        uint64_t interval = start - inst->lastStart;
+        hist_record( &inst->interval, interval );
+        hist_record( &inst->jitter, interval > periodNs ? interval - periodNs : periodNs - interval );
+    }
+    inst->lastStart = start;
+
+    return start;
+}
+
+//-----------------------------------------------------------------------------
+// name: inst_callback_end()
+// desc: record time spent in the callback and the current latency
+//-----------------------------------------------------------------------------
+void inst_callback_end( Instrument * inst, uint64_t start, long latencyFrames )
+{
+    hist_record( &inst->callback, inst_now() - start );
+    if( latencyFrames > 0 )
+        hist_record( &inst->latency, (uint64_t)latencyFrames );
+    inst->callbacks.store( inst->callbacks.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+}
+
+//-----------------------------------------------------------------------------
+// name: inst_dump_hist()
+// desc: one summary line for a histogram
+//-----------------------------------------------------------------------------
+static void inst_dump_hist( std::ostream & out, const char * name, const Histogram * h,
+                            double scale, const char * unit )
+{
+    char line[256];
+    snprintf( line, sizeof(line),
+              "  %-9s n=%-9llu mean=%9.3f p50=%9.3f p90=%9.3f p99=%9.3f p99.9=%9.3f max=%9.3f %s",
+              name, (unsigned long long)h->total.load( std::memory_order_acquire ),
+              hist_mean( h ) * scale,
+              hist_percentile( h, 50 ) * scale, hist_percentile( h, 90 ) * scale,
+              hist_percentile( h, 99 ) * scale, hist_percentile( h, 99.9 ) * scale,
+              h->max.load( std::memory_order_relaxed ) * scale, unit );
+    out << line << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+// name: inst_dump()
+// desc: print counters and histogram summaries
+//-----------------------------------------------------------------------------
+void inst_dump( const Instrument * inst, std::ostream & out )
+{
+    out << "---------------- audio callback stats ----------------" << std::endl;
+    out << "  callbacks=" << inst->callbacks.load( std::memory_order_acquire )
+        << " input overflows=" << inst->overflows.load( std::memory_order_relaxed )
+        << " output underflows=" << inst->underflows.load( std::memory_order_relaxed ) << std::endl;
+    inst_dump_hist( out, "callback", &inst->callback, 1e-3, "us" );
+    inst_dump_hist( out, "interval", &inst->interval, 1e-6, "ms" );
+    inst_dump_hist( out, "jitter", &inst->jitter, 1e-3, "us" );
+    inst_dump_hist( out, "latency", &inst->latency, 1.0, "frames" );
+    out << "------------------------------------------------------" << std::endl;
+}
@@ -0,0 +1,84 @@
+//-----------------------------------------------------------------------------
+// name: instrument.h
+// desc: lock-free real-time instrumentation for the audio callback
+//
+//   each Histogram has exactly one writer (the thread being measured) and
+//   any number of readers; recording is a couple of relaxed atomic stores,
+//   so it is safe to call from the audio callback.
+//-----------------------------------------------------------------------------
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+
+
+// HDR-style buckets: each power of two is split into HIST_SUB linear
+// sub-buckets, so any recorded value is off by at most 1/HIST_SUB
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+// largest tracked value is 2^HIST_MAX_BITS - 1 (larger values are clamped)
+#define HIST_MAX_BITS 41
+#define HIST_BUCKETS ( (HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB )
+
+
+//-----------------------------------------------------------------------------
+// name: struct Histogram
+// desc: log-linear histogram with a single lock-free writer
+//-----------------------------------------------------------------------------
+struct Histogram
+{
+    std::atomic<uint32_t> counts[HIST_BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+};
+
+// zero a histogram (not concurrently with its writer)
+void hist_clear( Histogram * h );
+// record one value (single writer only)
+void hist_record( Histogram * h, uint64_t value );
+// value at percentile p (0-100), approximated by its bucket's upper bound
+uint64_t hist_percentile( const Histogram * h, double p );
+// mean of all recorded values
+double hist_mean( const Histogram * h );
+
+
+//-----------------------------------------------------------------------------
+// name: struct Instrument
+// desc: everything we measure about the audio callback
+//-----------------------------------------------------------------------------
+struct Instrument
+{
+    // ns spent inside the callback
+    Histogram callback;
+    // ns between the starts of consecutive callbacks
+    Histogram interval;
+    // |interval - nominal buffer period| in ns
+    Histogram jitter;
+    // stream latency reported by the backend (e.g. snd_pcm_delay), in frames
+    Histogram latency;
+
+    // counters
+    std::atomic<uint64_t> callbacks;
+    std::atomic<uint64_t> overflows;
+    std::atomic<uint64_t> underflows;
+
+    // writer-private: start of the previous callback
+    uint64_t lastStart;
+};
+
+// zero everything (before the stream starts)
+void inst_clear( Instrument * inst );
+// monotonic clock in ns
+uint64_t inst_now();
+// call first thing in the callback; returns the start timestamp
+uint64_t inst_callback_begin( Instrument * inst, unsigned int status, uint64_t periodNs );
+// call last thing in the callback
+void inst_callback_end( Instrument * inst, uint64_t start, long latencyFrames );
+// print a human readable summary
+void inst_dump( const Instrument * inst, std::ostream & out );
+
+
+#endif
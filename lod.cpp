@@ -0,0 +1,67 @@
+//-----------------------------------------------------------------------------
+// name: lod.cpp
+// desc: level-of-detail decimation of spectra for drawing
+//-----------------------------------------------------------------------------
+#include "lod.h"
+#include <stddef.h>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: lod_plan()
+// desc: equal buckets, sizes differing by at most one bin
+//-----------------------------------------------------------------------------
+void lod_plan( Lod * lod, long bins, long points )
+{
+    lod_free( lod );
+    if( points < 1 ) points = 1;
+    if( points > bins ) points = bins;
+
+    lod->bins = bins;
+    lod->points = points;
+    lod->start = new long[points + 1];
+    for( long i = 0; i <= points; i++ )
+        lod->start[i] = i * bins / points;
+    lod->out = new complex[points];
+}
+
+//-----------------------------------------------------------------------------
+// name: lod_apply()
+// desc: max-|X| per bucket (compared squared, no sqrt)
+//-----------------------------------------------------------------------------
+const complex * lod_apply( Lod * lod, const complex * in )
+{
+    if( lod->points >= lod->bins ) return in;
+
+    for( long i = 0; i < lod->points; i++ )
+    {
+        long best = lod->start[i];
+        float peak = in[best].re * in[best].re + in[best].im * in[best].im;
+        for( long k = best + 1; k < lod->start[i + 1]; k++ )
+        {
+            float power = in[k].re * in[k].re + in[k].im * in[k].im;
+            if( power > peak )
+            {
+                peak = power;
+                best = k;
+            }
+        }
+        lod->out[i] = in[best];
+    }
+    return lod->out;
+}
+
+//-----------------------------------------------------------------------------
+// name: lod_free()
+// desc: release the plan
+//-----------------------------------------------------------------------------
+void lod_free( Lod * lod )
+{
+    delete [] lod->start;
+    delete [] lod->out;
+    lod->start = NULL;
+    lod->out = NULL;
+    lod->bins = 0;
+    lod->points = 0;
+}
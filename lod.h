@@ -0,0 +1,39 @@
+//-----------------------------------------------------------------------------
+// name: lod.h
+// desc: level-of-detail decimation of spectra for drawing
+//
+//   a ring never needs more vertices than the pixels it covers.  the plan
+//   splits the bins into equal buckets once (on resize or fft size
+//   change); applying it keeps the loudest bin of each bucket, so narrow
+//   peaks survive the reduction.
+//-----------------------------------------------------------------------------
+#ifndef __LOD_H__
+#define __LOD_H__
+
+#include "chuck_fft.h"
+
+
+//-----------------------------------------------------------------------------
+// name: struct Lod
+// desc: bucket boundaries and the decimated output
+//-----------------------------------------------------------------------------
+struct Lod
+{
+    // input bins and output points (points <= bins)
+    long bins;
+    long points;
+    // bucket i covers bins [start[i], start[i+1])
+    long * start;
+    complex * out;
+};
+
+
+// plan for `bins` bins drawn with at most `points` vertices
+void lod_plan( Lod * lod, long bins, long points );
+// one point per bucket, the bin with the largest |X|; returns the
+// spectrum to draw (`in` itself when no reduction is needed)
+const complex * lod_apply( Lod * lod, const complex * in );
+void lod_free( Lod * lod );
+
+
+#endif
@@ -0,0 +1,216 @@
+//-----------------------------------------------------------------------------
+// name: metrics.cpp
+// desc: health metrics published to POSIX shared memory
+//-----------------------------------------------------------------------------
+#include "metrics.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+// monotonic time the segment was created
+static uint64_t g_metricsStart = 0;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: metrics_create()
+// desc: create the segment, size it and stamp the header
+//-----------------------------------------------------------------------------
+MetricsBlock * metrics_create( const char * name, unsigned int sampleRate, unsigned int bufferFrames )
+{
+    int fd = shm_open( name, O_RDWR | O_CREAT, 0644 );
+    if( fd < 0 ) return NULL;
+
+    if( ftruncate( fd, sizeof(MetricsBlock) ) < 0 )
+    {
+        close( fd );
+        return NULL;
+    }
+
+    void * p = mmap( NULL, sizeof(MetricsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( p == MAP_FAILED ) return NULL;
+
+    MetricsBlock * m = (MetricsBlock *)p;
+    memset( (void *)m, 0, sizeof(MetricsBlock) );
+    m->version = METRICS_VERSION;
+    m->size = sizeof(MetricsBlock);
+    m->pid = (uint32_t)getpid();
+    m->sampleRate = sampleRate;
+    m->bufferFrames = bufferFrames;
+    m->seq.store( 0, std::memory_order_relaxed );
+    g_metricsStart = inst_now();
+    // magic last: readers ignore the segment until it is stamped
+    std::atomic_thread_fence( std::memory_order_release );
+    m->magic = METRICS_MAGIC;
+
+    return m;
+}
+
+//-----------------------------------------------------------------------------
+// name: metrics_destroy()
+// desc: unmap and unlink
+//-----------------------------------------------------------------------------
+void metrics_destroy( MetricsBlock * m, const char * name )
+{
+    if( !m ) return;
+    munmap( (void *)m, sizeof(MetricsBlock) );
+    shm_unlink( name );
+}
+
+//-----------------------------------------------------------------------------
+// name: metrics_summary()
+// desc: summarize a histogram
+//-----------------------------------------------------------------------------
+static void metrics_summary( MetricsHist * out, const Histogram * h )
+{
+    out->count = h->total.load( std::memory_order_acquire );
+    out->mean = (uint64_t)( hist_mean( h ) + 0.5 );
+    out->p50 = hist_percentile( h, 50 );
+    out->p90 = hist_percentile( h, 90 );
+    out->p99 = hist_percentile( h, 99 );
+    out->max = h->max.load( std::memory_order_relaxed );
+}
+
+//-----------------------------------------------------------------------------
+// name: metrics_memory()
+// desc: current and peak resident set size in bytes
+//-----------------------------------------------------------------------------
+static void metrics_memory( uint64_t * rss, uint64_t * peak )
+{
+    struct rusage usage;
+    *rss = 0;
+    *peak = 0;
+
+    if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+    {
+#ifdef __APPLE__
+        *peak = (uint64_t)usage.ru_maxrss;
+#else
+        *peak = (uint64_t)usage.ru_maxrss * 1024;
+#endif
+    }
+
+    // current rss is only cheap to get on linux
+    FILE * f = fopen( "/proc/self/statm", "r" );
+    if( f )
+    {
+        unsigned long size, resident;
+        if( fscanf( f, "%lu %lu", &size, &resident ) == 2 )
+            *rss = (uint64_t)resident * sysconf( _SC_PAGESIZE );
+        fclose( f );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: metrics_publish()
+// desc: gather outside the seqlock, then copy in under it
+//-----------------------------------------------------------------------------
+void metrics_publish( MetricsBlock * m, const Instrument * inst, const Histogram * frame,
+                      uint64_t queueDepth, uint64_t queueMax )
+{
+    if( !m ) return;
+
+    MetricsHist callback, interval, jitter, latency, frameNs;
+    metrics_summary( &callback, &inst->callback );
+    metrics_summary( &interval, &inst->interval );
+    metrics_summary( &jitter, &inst->jitter );
+    metrics_summary( &latency, &inst->latency );
+    metrics_summary( &frameNs, frame );
+    uint64_t rss, peak;
+    metrics_memory( &rss, &peak );
+    struct timespec now;
+    clock_gettime( CLOCK_REALTIME, &now );
+
+    // begin write
+    uint32_t seq = m->seq.load( std::memory_order_relaxed );
+    m->seq.store( seq + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    m->updated = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    m->uptime = inst_now() - g_metricsStart;
+    m->callbacks = inst->callbacks.load( std::memory_order_acquire );
+    m->overflows = inst->overflows.load( std::memory_order_relaxed );
+    m->underflows = inst->underflows.load( std::memory_order_relaxed );
+    m->callbackNs = callback;
+    m->intervalNs = interval;
+    m->jitterNs = jitter;
+    m->latencyFrames = latency;
+    m->frames = frameNs.count;
+    m->frameNs = frameNs;
+    m->queueDepth = queueDepth;
+    m->queueMax = queueMax;
+    m->rss = rss;
+    m->peakRss = peak;
+
+    // end write
+    m->seq.store( seq + 2, std::memory_order_release );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: metrics_open()
+// desc: map read-only and check the header
+//-----------------------------------------------------------------------------
+const MetricsBlock * metrics_open( const char * name )
+{
+    int fd = shm_open( name, O_RDONLY, 0 );
+    if( fd < 0 ) return NULL;
+
+    struct stat st;
+    if( fstat( fd, &st ) < 0 || st.st_size < (off_t)sizeof(MetricsBlock) )
+    {
+        close( fd );
+        return NULL;
+    }
+
+    void * p = mmap( NULL, sizeof(MetricsBlock), PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( p == MAP_FAILED ) return NULL;
+
+    const MetricsBlock * m = (const MetricsBlock *)p;
+    if( m->magic != METRICS_MAGIC || m->version != METRICS_VERSION )
+    {
+        munmap( p, sizeof(MetricsBlock) );
+        return NULL;
+    }
+
+    return m;
+}
+
+//-----------------------------------------------------------------------------
+// name: metrics_close()
+// desc: unmap
+//-----------------------------------------------------------------------------
+void metrics_close( const MetricsBlock * m )
+{
+    if( m ) munmap( (void *)m, sizeof(MetricsBlock) );
+}
+
+//-----------------------------------------------------------------------------
+// name: metrics_read()
+// desc: seqlock read
+//-----------------------------------------------------------------------------
+bool metrics_read( const MetricsBlock * m, MetricsBlock * copy )
+{
+    for( int tries = 0; tries < 1000; tries++ )
+    {
+        uint32_t before = m->seq.load( std::memory_order_acquire );
+        if( before & 1 ) continue;
+        memcpy( (void *)copy, (const void *)m, sizeof(MetricsBlock) );
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if( m->seq.load( std::memory_order_relaxed ) == before )
+            return true;
+    }
+
+    return false;
+}
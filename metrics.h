@@ -0,0 +1,103 @@
+//-----------------------------------------------------------------------------
+// name: metrics.h
+// desc: health metrics published to POSIX shared memory
+//
+//   the segment holds one MetricsBlock guarded by a seqlock: the writer
+//   makes seq odd, updates the fields and makes it even again; a reader
+//   copies the block and retries if seq was odd or changed meanwhile.
+//   the writer never waits for readers.
+//-----------------------------------------------------------------------------
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include "instrument.h"
+#include <atomic>
+#include <stdint.h>
+
+
+// default segment name (shows up as /dev/shm/sound-sphere.metrics on linux)
+#define METRICS_SHM_NAME "/sound-sphere.metrics"
+// 'SSMT'
+#define METRICS_MAGIC 0x544d5353
+// bump when the layout of MetricsBlock changes
+#define METRICS_VERSION 1
+
+
+//-----------------------------------------------------------------------------
+// name: struct MetricsHist
+// desc: summary of a Histogram, in the histogram's units
+//-----------------------------------------------------------------------------
+struct MetricsHist
+{
+    uint64_t count;
+    uint64_t mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct MetricsBlock
+// desc: layout of the shared segment
+//-----------------------------------------------------------------------------
+struct MetricsBlock
+{
+    // identification, written once
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t pid;
+
+    // seqlock, odd while the writer is updating
+    std::atomic<uint32_t> seq;
+    // stream configuration
+    uint32_t sampleRate;
+    uint32_t bufferFrames;
+    uint32_t reserved;
+
+    // CLOCK_REALTIME of the last update, ns
+    uint64_t updated;
+    // ns since the segment was created
+    uint64_t uptime;
+
+    // audio callback
+    uint64_t callbacks;
+    uint64_t overflows;
+    uint64_t underflows;
+    MetricsHist callbackNs;
+    MetricsHist intervalNs;
+    MetricsHist jitterNs;
+    MetricsHist latencyFrames;
+
+    // rendering
+    uint64_t frames;
+    MetricsHist frameNs;
+
+    // analysis hops queued but not yet processed, current and maximum seen
+    uint64_t queueDepth;
+    uint64_t queueMax;
+
+    // resident set size, current and peak, bytes
+    uint64_t rss;
+    uint64_t peakRss;
+};
+
+
+// create (or take over) the segment for writing; NULL on failure
+MetricsBlock * metrics_create( const char * name, unsigned int sampleRate, unsigned int bufferFrames );
+// unmap and remove the segment
+void metrics_destroy( MetricsBlock * m, const char * name );
+// take a snapshot of everything and publish it under the seqlock
+void metrics_publish( MetricsBlock * m, const Instrument * inst, const Histogram * frame,
+                      uint64_t queueDepth, uint64_t queueMax );
+
+// map an existing segment read-only; NULL on failure
+const MetricsBlock * metrics_open( const char * name );
+// unmap a segment opened with metrics_open()
+void metrics_close( const MetricsBlock * m );
+// consistent copy of the shared block; false if it never settles
+bool metrics_read( const MetricsBlock * m, MetricsBlock * copy );
+
+
+#endif
@@ -0,0 +1,134 @@
+//-----------------------------------------------------------------------------
+// name: pitch.cpp
+// desc: yin pitch tracking with an fft autocorrelation
+//-----------------------------------------------------------------------------
+#include "pitch.h"
+#include "chuck_fft.h"
+#include <math.h>
+#include <string.h>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pitch_create()
+// desc: lag range and scratch for every channel
+//-----------------------------------------------------------------------------
+Pitch * pitch_create( unsigned int size, unsigned int sampleRate, unsigned int channels )
+{
+    if( size < 64 || ( size & ( size - 1 ) ) ) return NULL;
+
+    // the parabola needs a lag on either side, and the search at least two
+    unsigned int minLag = (unsigned int)( sampleRate / PITCH_FMAX );
+    if( minLag < 2 ) minLag = 2;
+    unsigned int maxLag = size / 2 - 1;
+    if( minLag + 1 >= maxLag ) return NULL;
+
+    Pitch * p = new Pitch;
+    p->size = size;
+    p->sampleRate = sampleRate;
+    p->channels = channels;
+    p->minLag = minLag;
+    p->maxLag = maxLag;
+    p->half = new float[(size_t)channels * size];
+    p->full = new float[(size_t)channels * size];
+    p->diff = new float[(size_t)channels * size / 2];
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+// name: pitch_destroy()
+// desc: free the scratch
+//-----------------------------------------------------------------------------
+void pitch_destroy( Pitch * p )
+{
+    if( !p ) return;
+    delete [] p->half;
+    delete [] p->full;
+    delete [] p->diff;
+    delete p;
+}
+
+//-----------------------------------------------------------------------------
+// name: pitch_detect()
+// desc: correlation by fft, difference from it and the running energy,
+//       then the threshold search
+//-----------------------------------------------------------------------------
+void pitch_detect( Pitch * p, unsigned int channel, const float * x, const FftPlan * plan,
+                   double * scratch, PitchEstimate * out )
+{
+    unsigned int N = p->size, W = N / 2;
+    float * half = p->half + (size_t)channel * N;
+    float * full = p->full + (size_t)channel * N;
+    float * d = p->diff + (size_t)channel * W;
+
+    memcpy( half, x, sizeof(float) * W );
+    memset( half + W, 0, sizeof(float) * W );
+    memcpy( full, x, sizeof(float) * N );
+    fft_plan_rfft( plan, half, scratch, FFT_FORWARD );
+    fft_plan_rfft( plan, full, scratch, FFT_FORWARD );
+
+    // conj(H) F; bin 0 packs the real DC and Nyquist terms.  the forward
+    // transform scales forward by 1/N, so the inverse comes back as r(t) / N, and
+    // with no lag above W the first half never wraps into the zero pad
+    half[0] *= full[0];
+    half[1] *= full[1];
+    for( unsigned int k = 2; k < N; k += 2 )
+    {
+        float hr = half[k], hi = half[k+1];
+        half[k] = hr * full[k] + hi * full[k+1];
+        half[k+1] = hr * full[k+1] - hi * full[k];
+    }
+    fft_plan_rfft( plan, half, scratch, FFT_INVERSE );
+
+    // d(t) = e(0) + e(t) - 2 r(t), normalized by its mean over 1..t
+    double e0 = 0;
+    for( unsigned int j = 0; j < W; j++ )
+        e0 += (double)x[j] * x[j];
+    double e = e0, sum = 0;
+    d[0] = 1.0f;
+    for( unsigned int t = 1; t < W; t++ )
+    {
+        e += (double)x[t+W-1] * x[t+W-1] - (double)x[t-1] * x[t-1];
+        double dt = e0 + e - 2.0 * N * half[t];
+        if( dt < 0 ) dt = 0;
+        sum += dt;
+        d[t] = sum > 0 ? (float)( dt * t / sum ) : 1.0f;
+    }
+
+    // first dip under the threshold, followed to its bottom; otherwise
+    // the deepest point in range
+    unsigned int best = 0;
+    for( unsigned int t = p->minLag; t < p->maxLag; t++ )
+        if( d[t] < PITCH_THRESHOLD )
+        {
+            while( t + 1 < p->maxLag && d[t+1] < d[t] ) t++;
+            best = t;
+            break;
+        }
+    if( !best )
+    {
+        best = p->minLag;
+        for( unsigned int t = p->minLag + 1; t < p->maxLag; t++ )
+            if( d[t] < d[best] ) best = t;
+    }
+
+    float dip = d[best];
+    if( dip >= 1.0f )
+    {
+        out->f0 = 0.0f;
+        out->confidence = 0.0f;
+        return;
+    }
+
+    float lag = (float)best;
+    float a = d[best-1], b = d[best], c = d[best+1];
+    float curve = a - 2.0f * b + c;
+    if( curve > 0 )
+    {
+        float shift = 0.5f * ( a - c ) / curve;
+        if( shift > -1.0f && shift < 1.0f ) lag += shift;
+    }
+    out->f0 = p->sampleRate / lag;
+    out->confidence = dip < 0 ? 1.0f : 1.0f - dip;
+}
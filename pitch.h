@@ -0,0 +1,77 @@
+//-----------------------------------------------------------------------------
+// name: pitch.h
+// desc: yin pitch tracking with an fft autocorrelation
+//
+//   for a window of N samples, yin compares the first half with itself
+//   shifted by each lag t < N/2:  d(t) = sum (x[j] - x[j+t])^2, which
+//   expands to e(0) + e(t) - 2 r(t) with e(t) the energy of x[t .. t+N/2)
+//   and r(t) the correlation of the first half with the window.  the
+//   energies come from a running sum and r from one forward transform of
+//   each and one inverse, all through the caller's N/2 plan (so at its
+//   precision), so a lag sweep is O(N log N) instead of O(N^2).  d is
+//   then normalized by its running mean, and the first dip below the
+//   threshold (or failing that, the deepest one) is refined by a parabola
+//   through its neighbours.  f0 = sampleRate / lag, and confidence is one
+//   minus the normalized difference there.
+//
+//   the window is the analysis thread's raw (unwindowed) fftSize frame,
+//   so the lowest pitch found is 2 * sampleRate / fftSize.
+//-----------------------------------------------------------------------------
+#ifndef __PITCH_H__
+#define __PITCH_H__
+
+#include "fftplan.h"
+
+// highest f0 looked for, Hz
+#define PITCH_FMAX 2000.0f
+// normalized difference below which a dip counts as periodic
+#define PITCH_THRESHOLD 0.15f
+// confidence above which a pitch is worth showing
+#define PITCH_CONFIDENT 0.8f
+
+
+//-----------------------------------------------------------------------------
+// name: struct PitchEstimate
+// desc: one channel's result for one hop
+//-----------------------------------------------------------------------------
+struct PitchEstimate
+{
+    // Hz, 0 if nothing periodic was found
+    float f0;
+    // 0 (noise) .. 1 (perfectly periodic)
+    float confidence;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct Pitch
+// desc: lag range and per-channel scratch
+//-----------------------------------------------------------------------------
+struct Pitch
+{
+    // window length (a power of two) and lags searched, [minLag, maxLag)
+    unsigned int size;
+    unsigned int sampleRate;
+    unsigned int channels;
+    unsigned int minLag;
+    unsigned int maxLag;
+    // [channels][size]: first half zero-padded, then the correlation;
+    // the whole window, then its transform
+    float * half;
+    float * full;
+    // [channels][size / 2]: normalized difference per lag
+    float * diff;
+};
+
+
+// tracker for size-sample windows (a power of two, at least 64); NULL if
+// that leaves no lags between sampleRate / PITCH_FMAX and size / 2
+Pitch * pitch_create( unsigned int size, unsigned int sampleRate, unsigned int channels );
+void pitch_destroy( Pitch * p );
+// estimate one channel's pitch from its newest size samples with plan
+// (size / 2 points) and the scratch fft_plan_rfft() wants; channels have
+// separate scratch so shards can run them in parallel
+void pitch_detect( Pitch * p, unsigned int channel, const float * x, const FftPlan * plan,
+                   double * scratch, PitchEstimate * out );
+
+
+#endif
@@ -0,0 +1,271 @@
+//-----------------------------------------------------------------------------
+// name: recorder.cpp
+// desc: archive the input audio to disk without file i/o in the callback
+//-----------------------------------------------------------------------------
+#include "recorder.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// how long the writer sleeps when there is nothing to write, ns
+#define RECORDER_IDLE_NS 5000000L
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: recorder_sync()
+// desc: flush file data (no fdatasync on OS X)
+//-----------------------------------------------------------------------------
+static void recorder_sync( int fd )
+{
+#ifdef __APPLE__
+    fsync( fd );
+#else
+    fdatasync( fd );
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// name: recorder_put()
+// desc: write a whole buffer, retrying short writes
+//-----------------------------------------------------------------------------
+static bool recorder_put( Recorder * rec, const char * data, size_t bytes )
+{
+    while( bytes > 0 )
+    {
+        ssize_t n = write( rec->fd, data, bytes );
+        if( n < 0 )
+        {
+            if( errno == EINTR ) continue;
+            return false;
+        }
+        data += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// name: recorder_thread()
+// desc: write full buffers and return them to the pool
+//-----------------------------------------------------------------------------
+static void * recorder_thread( void * data )
+{
+    Recorder * rec = (Recorder *)data;
+    struct timespec idle = { 0, RECORDER_IDLE_NS };
+    uint64_t unsynced = 0;
+
+    for( ;; )
+    {
+        RecorderBlock block;
+        if( !rec->full.pop( block ) )
+        {
+            if( !rec->running.load( std::memory_order_acquire ) ) break;
+            nanosleep( &idle, NULL );
+            continue;
+        }
+
+        if( !rec->failed )
+        {
+            if( recorder_put( rec, rec->pool[block.index], block.bytes ) )
+                rec->written += block.bytes;
+            else
+            {
+                perror( "[sound-sphere]: recording write failed" );
+                rec->failed = true;
+            }
+        }
+        rec->free.push( block.index );
+
+        unsynced += block.bytes;
+        if( unsynced >= RECORDER_SYNC_BYTES )
+        {
+            recorder_sync( rec->fd );
+            unsynced = 0;
+        }
+    }
+
+    return NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: recorder_capacity()
+// desc: largest fill that is both whole frames and whole alignment
+//       units: a multiple of lcm( frameBytes, RECORDER_ALIGN ); 0 if even
+//       one such unit doesn't fit a pool buffer
+//-----------------------------------------------------------------------------
+static unsigned int recorder_capacity( unsigned int frameBytes )
+{
+    unsigned int a = frameBytes, b = RECORDER_ALIGN;
+    while( b )
+    {
+        unsigned int t = a % b;
+        a = b;
+        b = t;
+    }
+    uint64_t unit = (uint64_t)frameBytes / a * RECORDER_ALIGN;
+    return (unsigned int)( RECORDER_BUFFER_BYTES / unit * unit );
+}
+
+//-----------------------------------------------------------------------------
+// name: recorder_start()
+// desc: open the file, allocate and prefault the pool, start the writer
+//-----------------------------------------------------------------------------
+Recorder * recorder_start( const char * path, unsigned int channels )
+{
+    const unsigned int frameBytes = sizeof(float) * channels;
+    unsigned int capacity = recorder_capacity( frameBytes );
+    bool direct = false;
+    int fd = -1;
+#ifdef O_DIRECT
+    // not every filesystem supports it (tmpfs doesn't), and frames too
+    // odd to fill whole aligned buffers can't use it at all
+    if( capacity )
+    {
+        fd = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644 );
+        direct = fd >= 0;
+    }
+#endif
+    if( fd < 0 )
+        fd = open( path, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( fd < 0 ) return NULL;
+#ifdef F_NOCACHE
+    direct = fcntl( fd, F_NOCACHE, 1 ) == 0;
+#endif
+    if( !direct || !capacity )
+        capacity = RECORDER_BUFFER_BYTES / frameBytes * frameBytes;
+
+    Recorder * rec = new Recorder;
+    rec->fd = fd;
+    rec->direct = direct;
+    rec->capacity = capacity;
+    rec->free.init( RECORDER_BUFFERS );
+    rec->full.init( RECORDER_BUFFERS );
+    for( int i = 0; i < RECORDER_BUFFERS; i++ )
+    {
+        void * p = NULL;
+        if( posix_memalign( &p, RECORDER_ALIGN, RECORDER_BUFFER_BYTES ) )
+        {
+            for( int j = 0; j < i; j++ ) free( rec->pool[j] );
+            close( fd );
+            delete rec;
+            return NULL;
+        }
+        // touch every page so the callback never faults
+        memset( p, 0, RECORDER_BUFFER_BYTES );
+        rec->pool[i] = (char *)p;
+        rec->free.push( i );
+    }
+    rec->current = -1;
+    rec->fill = 0;
+    rec->dropped.store( 0 );
+    rec->written = 0;
+    rec->failed = false;
+    rec->running.store( true );
+
+    if( pthread_create( &rec->thread, NULL, recorder_thread, rec ) )
+    {
+        for( int i = 0; i < RECORDER_BUFFERS; i++ ) free( rec->pool[i] );
+        close( fd );
+        delete rec;
+        return NULL;
+    }
+
+    return rec;
+}
+
+//-----------------------------------------------------------------------------
+// name: recorder_write()
+// desc: interleave into the current buffer, swap buffers when it fills up
+//-----------------------------------------------------------------------------
+void recorder_write( Recorder * rec, const float * input, unsigned int frames, unsigned int channels )
+{
+    if( !rec->running.load( std::memory_order_relaxed ) ) return;
+
+    // buffers hold whole frames so channels never straddle two of them
+    const unsigned int frameBytes = sizeof(float) * channels;
+    const unsigned int capacity = rec->capacity;
+    unsigned int i = 0;
+    while( i < frames )
+    {
+        if( rec->current < 0 )
+        {
+            if( !rec->free.pop( rec->current ) )
+            {
+                // writer is behind: lose this audio rather than wait
+                rec->current = -1;
+                rec->dropped.store( rec->dropped.load( std::memory_order_relaxed ) + (uint64_t)( frames - i ) * frameBytes,
+                                    std::memory_order_relaxed );
+                return;
+            }
+            rec->fill = 0;
+        }
+
+        float * dst = (float *)( rec->pool[rec->current] + rec->fill );
+        unsigned int n = ( capacity - rec->fill ) / frameBytes;
+        if( n > frames - i ) n = frames - i;
+        if( channels == 1 )
+            memcpy( dst, input + i, sizeof(float) * n );
+        else
+        {
+            for( unsigned int j = 0; j < n; j++ )
+                for( unsigned int c = 0; c < channels; c++ )
+                    *dst++ = input[(size_t)c * frames + i + j];
+        }
+        rec->fill += n * frameBytes;
+        i += n;
+
+        if( rec->fill == capacity )
+        {
+            RecorderBlock block = { rec->current, rec->fill };
+            rec->full.push( block );
+            rec->current = -1;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: recorder_stop()
+// desc: drain, write the partial buffer padded to alignment, trim the file
+//-----------------------------------------------------------------------------
+void recorder_stop( Recorder * rec )
+{
+    if( !rec ) return;
+
+    rec->running.store( false, std::memory_order_release );
+    pthread_join( rec->thread, NULL );
+
+    uint64_t size = rec->written;
+    if( !rec->failed && rec->current >= 0 && rec->fill > 0 )
+    {
+        unsigned int padded = ( rec->fill + RECORDER_ALIGN - 1 ) & ~( RECORDER_ALIGN - 1 );
+        memset( rec->pool[rec->current] + rec->fill, 0, padded - rec->fill );
+        if( recorder_put( rec, rec->pool[rec->current], padded ) )
+            size += rec->fill;
+    }
+    // drop the padding
+    if( ftruncate( rec->fd, size ) < 0 )
+        perror( "[sound-sphere]: cannot trim recording" );
+    recorder_sync( rec->fd );
+    close( rec->fd );
+
+    uint64_t dropped = rec->dropped.load();
+    fprintf( stderr, "[sound-sphere]: recorded %.1f MB%s%s", size / 1048576.0,
+             rec->direct ? " (direct i/o)" : "", rec->failed ? " before a write failed" : "" );
+    if( dropped )
+        fprintf( stderr, ", dropped %.1f MB", dropped / 1048576.0 );
+    fprintf( stderr, "\n" );
+
+    for( int i = 0; i < RECORDER_BUFFERS; i++ )
+        free( rec->pool[i] );
+    delete rec;
+}
@@ -0,0 +1,82 @@
+//-----------------------------------------------------------------------------
+// name: recorder.h
+// desc: archive the input audio to disk without file i/o in the callback
+//
+//   the callback copies samples into one of a fixed pool of page-aligned
+//   buffers; full buffers go to a writer thread through a lock-free queue
+//   and come back through a second one once written.  the writer uses
+//   O_DIRECT where the filesystem allows it (F_NOCACHE on OS X), writes
+//   whole aligned buffers and calls fdatasync periodically.
+//
+//   output is headerless float32 in host byte order, interleaved.
+//-----------------------------------------------------------------------------
+#ifndef __RECORDER_H__
+#define __RECORDER_H__
+
+#include "ringbuffer.h"
+#include <atomic>
+#include <stdint.h>
+#include <pthread.h>
+
+
+// bytes per pool buffer (a multiple of the O_DIRECT alignment)
+#define RECORDER_BUFFER_BYTES (1 << 20)
+// buffers in the pool
+#define RECORDER_BUFFERS 16
+// alignment for O_DIRECT
+#define RECORDER_ALIGN 4096
+// fdatasync after this many bytes
+#define RECORDER_SYNC_BYTES (16 << 20)
+
+
+//-----------------------------------------------------------------------------
+// name: struct RecorderBlock
+// desc: a pool buffer handed between the threads
+//-----------------------------------------------------------------------------
+struct RecorderBlock
+{
+    int index;
+    unsigned int bytes;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct Recorder
+// desc: recording state
+//-----------------------------------------------------------------------------
+struct Recorder
+{
+    int fd;
+    bool direct;
+    // bytes a pool buffer is filled to: whole frames, and a multiple of
+    // RECORDER_ALIGN so O_DIRECT accepts the write
+    unsigned int capacity;
+    char * pool[RECORDER_BUFFERS];
+    // empty buffers (writer -> callback) and full ones (callback -> writer)
+    SpscRing<int> free;
+    SpscRing<RecorderBlock> full;
+
+    // callback-private: buffer being filled, -1 if none was free
+    int current;
+    unsigned int fill;
+
+    pthread_t thread;
+    std::atomic<bool> running;
+    // bytes the callback had to discard because no buffer was free
+    std::atomic<uint64_t> dropped;
+    // bytes the writer thread got to disk, and whether a write failed
+    // (nothing more is written after one)
+    uint64_t written;
+    bool failed;
+};
+
+
+// open path and start the writer for interleaved frames of `channels`
+// floats; NULL on failure
+Recorder * recorder_start( const char * path, unsigned int channels );
+// interleave and copy one callback's non-interleaved input (audio thread)
+void recorder_write( Recorder * rec, const float * input, unsigned int frames, unsigned int channels );
+// flush the partial buffer, sync and close
+void recorder_stop( Recorder * rec );
+
+
+#endif
@@ -0,0 +1,121 @@
+//-----------------------------------------------------------------------------
+// name: ringbuffer.h
+// desc: lock-free single-producer/single-consumer ring buffer
+//
+//   one thread pushes, one thread pops; neither ever blocks or allocates
+//   after init(), so either side may be the audio callback.  capacity is
+//   rounded up to a power of two.
+//-----------------------------------------------------------------------------
+#ifndef __RINGBUFFER_H__
+#define __RINGBUFFER_H__
+
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+// name: class SpscRing
+// desc: T must be trivially copyable
+//-----------------------------------------------------------------------------
+template <typename T>
+class SpscRing
+{
+public:
+    SpscRing() : buffer_(NULL), size_(0), mask_(0), head_(0), tail_(0) {}
+    ~SpscRing() { delete [] buffer_; }
+
+    // allocate room for at least `capacity` items (not thread safe)
+    bool init( size_t capacity )
+    {
+        size_t size = 1;
+        while( size < capacity ) size <<= 1;
+        delete [] buffer_;
+        buffer_ = new T[size];
+        memset( (void *)buffer_, 0, sizeof(T) * size );
+        size_ = size;
+        mask_ = size - 1;
+        head_.store( 0 );
+        tail_.store( 0 );
+        return true;
+    }
+
+    size_t capacity() const { return size_; }
+
+    // items available to pop (consumer side; a lower bound elsewhere)
+    size_t readable() const
+    { return head_.load( std::memory_order_acquire ) - tail_.load( std::memory_order_relaxed ); }
+
+    // free space (producer side; a lower bound elsewhere)
+    size_t writable() const
+    { return size_ - ( head_.load( std::memory_order_relaxed ) - tail_.load( std::memory_order_acquire ) ); }
+
+    // push all n items or none
+    bool push( const T * src, size_t n )
+    {
+        size_t head = head_.load( std::memory_order_relaxed );
+        if( size_ - ( head - tail_.load( std::memory_order_acquire ) ) < n ) return false;
+        copyIn( head, src, n );
+        head_.store( head + n, std::memory_order_release );
+        return true;
+    }
+
+    bool push( const T & item ) { return push( &item, 1 ); }
+
+    // pop exactly n items or none
+    bool pop( T * dst, size_t n )
+    {
+        if( !peek( dst, n, 0 ) ) return false;
+        skip( n );
+        return true;
+    }
+
+    bool pop( T & item ) { return pop( &item, 1 ); }
+
+    // copy n items starting `offset` items past the read position, leave them queued
+    bool peek( T * dst, size_t n, size_t offset ) const
+    {
+        size_t tail = tail_.load( std::memory_order_relaxed );
+        if( head_.load( std::memory_order_acquire ) - tail < n + offset ) return false;
+        copyOut( tail + offset, dst, n );
+        return true;
+    }
+
+    // drop n queued items (consumer side)
+    void skip( size_t n )
+    { tail_.store( tail_.load( std::memory_order_relaxed ) + n, std::memory_order_release ); }
+
+private:
+    void copyIn( size_t pos, const T * src, size_t n )
+    {
+        size_t at = pos & mask_;
+        size_t first = n < size_ - at ? n : size_ - at;
+        memcpy( (void *)(buffer_ + at), src, sizeof(T) * first );
+        memcpy( (void *)buffer_, src + first, sizeof(T) * (n - first) );
+    }
+
+    void copyOut( size_t pos, T * dst, size_t n ) const
+    {
+        size_t at = pos & mask_;
+        size_t first = n < size_ - at ? n : size_ - at;
+        memcpy( (void *)dst, buffer_ + at, sizeof(T) * first );
+        memcpy( (void *)(dst + first), buffer_, sizeof(T) * (n - first) );
+    }
+
+    // no copying
+    SpscRing( const SpscRing & );
+    SpscRing & operator=( const SpscRing & );
+
+    T * buffer_;
+    size_t size_;
+    size_t mask_;
+    // producer and consumer positions on separate cache lines
+    char pad0_[64];
+    std::atomic<size_t> head_;
+    char pad1_[64];
+    std::atomic<size_t> tail_;
+    char pad2_[64];
+};
+
+
+#endif
@@ -0,0 +1,212 @@
+//-----------------------------------------------------------------------------
+// name: sdft.cpp
+// desc: sliding dft over a subset of bins, updated every sample
+//-----------------------------------------------------------------------------
+#include "sdft.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+
+// same slot bits as the analysis triple buffer
+#define SDFT_FRESH 4
+#define SDFT_SLOT_MASK 3
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: sdft_create()
+// desc: tracked bins, rotations and zeroed state
+//-----------------------------------------------------------------------------
+Sdft * sdft_create( unsigned int size, const unsigned int * bins, unsigned int count, unsigned int channels )
+{
+    // each bin needs both neighbours for the window
+    std::vector<unsigned int> requested;
+    for( unsigned int i = 0; i < count; i++ )
+        if( bins[i] >= 1 && bins[i] < size / 2 ) requested.push_back( bins[i] );
+    if( requested.empty() ) return NULL;
+
+    std::vector<unsigned int> tracked;
+    for( size_t i = 0; i < requested.size(); i++ )
+        for( unsigned int k = requested[i] - 1; k <= requested[i] + 1; k++ )
+            tracked.push_back( k );
+    std::sort( tracked.begin(), tracked.end() );
+    tracked.erase( std::unique( tracked.begin(), tracked.end() ), tracked.end() );
+
+    Sdft * s = new Sdft;
+    s->size = size;
+    s->bins = (unsigned int)requested.size();
+    s->channels = channels;
+    s->bin = new unsigned int[s->bins];
+    s->states = (unsigned int)tracked.size();
+    s->tap = new unsigned int[3 * s->bins];
+    for( unsigned int b = 0; b < s->bins; b++ )
+    {
+        s->bin[b] = requested[b];
+        for( int t = 0; t < 3; t++ )
+            s->tap[3*b+t] = (unsigned int)( std::lower_bound( tracked.begin(), tracked.end(),
+                                                              requested[b] - 1 + t ) - tracked.begin() );
+    }
+
+    s->rotRe = new double[s->states];
+    s->rotIm = new double[s->states];
+    for( unsigned int j = 0; j < s->states; j++ )
+    {
+        double w = 2.0 * M_PI * tracked[j] / size;
+        s->rotRe[j] = SDFT_DAMPING * cos( w );
+        s->rotIm[j] = SDFT_DAMPING * sin( w );
+    }
+    s->damp = pow( SDFT_DAMPING, (double)size );
+
+    s->re = new double[(size_t)channels * s->states];
+    s->im = new double[(size_t)channels * s->states];
+    s->delay = new float[(size_t)channels * size];
+    memset( s->re, 0, sizeof(double) * channels * s->states );
+    memset( s->im, 0, sizeof(double) * channels * s->states );
+    memset( s->delay, 0, sizeof(float) * channels * size );
+    s->pos = 0;
+    s->samples = 0;
+
+    for( int i = 0; i < 3; i++ )
+    {
+        s->slots[i] = new complex[(size_t)channels * s->bins];
+        memset( s->slots[i], 0, sizeof(complex) * channels * s->bins );
+    }
+    s->back = 0;
+    s->middle.store( 1 );
+    s->front = 2;
+
+    return s;
+}
+
+//-----------------------------------------------------------------------------
+// name: sdft_destroy()
+// desc: free everything
+//-----------------------------------------------------------------------------
+void sdft_destroy( Sdft * s )
+{
+    if( !s ) return;
+    delete [] s->bin;
+    delete [] s->tap;
+    delete [] s->rotRe;
+    delete [] s->rotIm;
+    delete [] s->re;
+    delete [] s->im;
+    delete [] s->delay;
+    for( int i = 0; i < 3; i++ )
+        delete [] s->slots[i];
+    delete s;
+}
+
+//-----------------------------------------------------------------------------
+// name: sdft_bins()
+// desc: comma-separated bins and inclusive ranges
+//-----------------------------------------------------------------------------
+int sdft_bins( const char * spec, unsigned int * out, unsigned int max )
+{
+    unsigned int count = 0;
+    const char * p = spec;
+    if( !p || !*p ) return -1;
+
+    for( ;; )
+    {
+        char * end = NULL;
+        if( *p < '0' || *p > '9' ) return -1;
+        unsigned long lo = strtoul( p, &end, 10 ), hi = lo;
+        if( *end == '-' )
+        {
+            p = end + 1;
+            if( *p < '0' || *p > '9' ) return -1;
+            hi = strtoul( p, &end, 10 );
+        }
+        if( hi < lo ) return -1;
+        for( unsigned long k = lo; k <= hi && count < max; k++ )
+            out[count++] = (unsigned int)k;
+        if( !*end ) return (int)count;
+        if( *end != ',' ) return -1;
+        p = end + 1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: sdft_update()
+// desc: the recursion, sample by sample; the inner loop runs across bins
+//       on separate re/im arrays so it vectorizes
+//-----------------------------------------------------------------------------
+void sdft_update( Sdft * s, unsigned int channel, const float * x, unsigned int n )
+{
+    double * re = s->re + (size_t)channel * s->states;
+    double * im = s->im + (size_t)channel * s->states;
+    float * delay = s->delay + (size_t)channel * s->size;
+    const double * rotRe = s->rotRe;
+    const double * rotIm = s->rotIm;
+    unsigned int states = s->states;
+    unsigned int pos = s->pos;
+
+    for( unsigned int i = 0; i < n; i++ )
+    {
+        double delta = x[i] - s->damp * delay[pos];
+        delay[pos] = x[i];
+        if( ++pos == s->size ) pos = 0;
+
+        for( unsigned int j = 0; j < states; j++ )
+        {
+            double r = re[j] + delta;
+            double m = im[j];
+            re[j] = r * rotRe[j] - m * rotIm[j];
+            im[j] = r * rotIm[j] + m * rotRe[j];
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// name: sdft_advance()
+// desc: every channel has taken n more samples
+//-----------------------------------------------------------------------------
+void sdft_advance( Sdft * s, unsigned int n )
+{
+    s->pos = (unsigned int)( ( s->pos + n ) % s->size );
+    s->samples += n;
+}
+
+//-----------------------------------------------------------------------------
+// name: sdft_publish()
+// desc: hann = 0.5 X_k - 0.25 (X_k-1 + X_k+1), scaled by 1/N so a sine at
+//       a bin reads the same |X| as the hann-windowed rfft()
+//-----------------------------------------------------------------------------
+void sdft_publish( Sdft * s )
+{
+    complex * out = s->slots[s->back];
+    double scale = 1.0 / s->size;
+
+    for( unsigned int c = 0; c < s->channels; c++ )
+    {
+        const double * re = s->re + (size_t)c * s->states;
+        const double * im = s->im + (size_t)c * s->states;
+        complex * o = out + (size_t)c * s->bins;
+        for( unsigned int b = 0; b < s->bins; b++ )
+        {
+            const unsigned int * t = s->tap + 3 * b;
+            o[b].re = (float)( scale * ( 0.5 * re[t[1]] - 0.25 * ( re[t[0]] + re[t[2]] ) ) );
+            o[b].im = (float)( scale * ( 0.5 * im[t[1]] - 0.25 * ( im[t[0]] + im[t[2]] ) ) );
+        }
+    }
+
+    s->back = s->middle.exchange( s->back | SDFT_FRESH, std::memory_order_acq_rel ) & SDFT_SLOT_MASK;
+}
+
+//-----------------------------------------------------------------------------
+// name: sdft_latest()
+// desc: triple-buffer read side
+//-----------------------------------------------------------------------------
+const complex * sdft_latest( Sdft * s, bool * fresh )
+{
+    bool isFresh = ( s->middle.load( std::memory_order_relaxed ) & SDFT_FRESH ) != 0;
+    if( isFresh )
+        s->front = s->middle.exchange( s->front, std::memory_order_acq_rel ) & SDFT_SLOT_MASK;
+    if( fresh ) *fresh = isFresh;
+    return s->slots[s->front];
+}
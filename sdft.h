@@ -0,0 +1,83 @@
+//-----------------------------------------------------------------------------
+// name: sdft.h
+// desc: sliding dft over a subset of bins, updated every sample
+//
+//   each tracked bin follows X_k <- r e^(iw_k) (X_k + x[n] - r^N x[n-N]),
+//   one complex multiply-add per bin per sample, so the spectrum of the
+//   newest N samples is current as soon as a sample arrives instead of
+//   once per hop.  r slightly below one keeps rounding error from
+//   accumulating.  a hann window is applied when reading, in the frequency
+//   domain, from each bin's two neighbours (tracked as well).
+//
+//   the state is advanced by the analysis thread, which reads the samples
+//   from the analysis rings ahead of the hop windows, and snapshots go to
+//   the renderer through a triple buffer like the analysis frames.
+//-----------------------------------------------------------------------------
+#ifndef __SDFT_H__
+#define __SDFT_H__
+
+#include "chuck_fft.h"
+#include <atomic>
+#include <stdint.h>
+
+
+// per-sample damping r
+#define SDFT_DAMPING 0.999999
+// most bins a spec may list
+#define SDFT_MAX_BINS 4096
+
+
+//-----------------------------------------------------------------------------
+// name: struct Sdft
+// desc: recursion state per channel and the renderer's triple buffer
+//-----------------------------------------------------------------------------
+struct Sdft
+{
+    // window length, and bins handed out per channel
+    unsigned int size;
+    unsigned int bins;
+    unsigned int channels;
+    unsigned int * bin;
+    // tracked bins (requested ones and their neighbours); output bin b is
+    // hann-combined from tracked states tap[3b .. 3b+2]
+    unsigned int states;
+    unsigned int * tap;
+    // r e^(iw) per tracked bin, and r^N
+    double * rotRe;
+    double * rotIm;
+    double damp;
+    // [channels][states]
+    double * re;
+    double * im;
+    // the last N samples of each channel, [channels][size]
+    float * delay;
+    unsigned int pos;
+    // samples consumed so far
+    uint64_t samples;
+
+    // renderer triple buffer, [channels][bins] per slot (same flags as
+    // the analysis frames)
+    complex * slots[3];
+    std::atomic<int> middle;
+    int back;
+    int front;
+};
+
+
+// track `count` bins (1 .. size/2 - 1) of a size-point window
+Sdft * sdft_create( unsigned int size, const unsigned int * bins, unsigned int count, unsigned int channels );
+void sdft_destroy( Sdft * s );
+// parse "1-64,80,100-120" into at most max bins; the count, or -1 if the
+// spec is malformed
+int sdft_bins( const char * spec, unsigned int * out, unsigned int max );
+
+// advance one channel by n samples, then sdft_advance() once for all
+void sdft_update( Sdft * s, unsigned int channel, const float * x, unsigned int n );
+void sdft_advance( Sdft * s, unsigned int n );
+// window the current state into the back slot and hand it over
+void sdft_publish( Sdft * s );
+// renderer: newest snapshot, [channels][bins]; *fresh as analysis_latest()
+const complex * sdft_latest( Sdft * s, bool * fresh );
+
+
+#endif
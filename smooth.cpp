@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+// name: smooth.cpp
+// desc: per-bin attack / release smoothing and peak hold with decay
+//-----------------------------------------------------------------------------
+#include "smooth.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: smooth_params()
+// desc: two or four non-negative numbers, comma-separated
+//-----------------------------------------------------------------------------
+bool smooth_params( const char * spec, SmoothParams * p )
+{
+    float v[4] = { 0, 0, 0, 0 };
+    int n = 0;
+    const char * s = spec;
+    if( !s || !*s ) return false;
+
+    for( ;; )
+    {
+        char * end = NULL;
+        if( n == 4 ) return false;
+        v[n] = (float)strtod( s, &end );
+        if( end == s || v[n] < 0 ) return false;
+        n++;
+        if( !*end ) break;
+        if( *end != ',' ) return false;
+        s = end + 1;
+    }
+    if( n != 2 && n != 4 ) return false;
+
+    p->attack = v[0];
+    p->release = v[1];
+    p->hold = v[2];
+    p->decay = v[3];
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// name: smooth_enabled()
+// desc: a peak hold without decay would never fall, so it doesn't count
+//-----------------------------------------------------------------------------
+bool smooth_enabled( const SmoothParams * p )
+{
+    return p->attack > 0 || p->release > 0 || p->decay > 0;
+}
+
+//-----------------------------------------------------------------------------
+// name: smooth_gain()
+// desc: one-pole gain per hop for a time constant in ms
+//-----------------------------------------------------------------------------
+static float smooth_gain( float ms, float hopRate )
+{
+    if( ms <= 0 ) return 1.0f;
+    return (float)( 1.0 - exp( -1000.0 / ( ms * hopRate ) ) );
+}
+
+//-----------------------------------------------------------------------------
+// name: smooth_create()
+// desc: per-hop coefficients and zeroed state
+//-----------------------------------------------------------------------------
+Smooth * smooth_create( unsigned int count, unsigned int channels, float hopRate, const SmoothParams * p )
+{
+    Smooth * s = new Smooth;
+    size_t n = (size_t)count * channels;
+    s->count = count;
+    s->channels = channels;
+    s->attack = smooth_gain( p->attack, hopRate );
+    s->release = smooth_gain( p->release, hopRate );
+    s->holdHops = p->hold * hopRate / 1000.0f;
+    s->decay = (float)pow( 10.0, -p->decay / ( 20.0 * hopRate ) );
+    s->peaks = p->decay > 0;
+    s->level = new float[n];
+    s->peak = new float[n];
+    s->hold = new float[n];
+    memset( s->level, 0, sizeof(float) * n );
+    memset( s->peak, 0, sizeof(float) * n );
+    memset( s->hold, 0, sizeof(float) * n );
+    return s;
+}
+
+//-----------------------------------------------------------------------------
+// name: smooth_destroy()
+// desc: free the state
+//-----------------------------------------------------------------------------
+void smooth_destroy( Smooth * s )
+{
+    if( !s ) return;
+    delete [] s->level;
+    delete [] s->peak;
+    delete [] s->hold;
+    delete s;
+}
+
+//-----------------------------------------------------------------------------
+// name: smooth_apply()
+// desc: follower, then peak hold; both written as selects so the loops
+//       if-convert into vector blends
+//-----------------------------------------------------------------------------
+void smooth_apply( Smooth * s, unsigned int channel, float * mag )
+{
+    unsigned int n = s->count;
+    float * __restrict level = s->level + (size_t)channel * n;
+    float * __restrict x = mag;
+    float attack = s->attack, release = s->release;
+
+    for( unsigned int k = 0; k < n; k++ )
+    {
+        float l = level[k], m = x[k];
+        l += ( m > l ? attack : release ) * ( m - l );
+        level[k] = l;
+        x[k] = l;
+    }
+    if( !s->peaks ) return;
+
+    float * __restrict peak = s->peak + (size_t)channel * n;
+    float * __restrict hold = s->hold + (size_t)channel * n;
+    float holdHops = s->holdHops, decay = s->decay;
+    for( unsigned int k = 0; k < n; k++ )
+    {
+        // a new peak restarts the hold; otherwise it falls once the
+        // hold runs out, but never below the level
+        float l = x[k], p = peak[k], h = hold[k];
+        float fallen = h > 0 ? p : p * decay;
+        hold[k] = l >= p ? holdHops : h - 1.0f;
+        p = fallen > l ? fallen : l;
+        peak[k] = p;
+        x[k] = p;
+    }
+}
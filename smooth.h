@@ -0,0 +1,64 @@
+//-----------------------------------------------------------------------------
+// name: smooth.h
+// desc: per-bin attack / release smoothing and peak hold with decay
+//
+//   each hop, every magnitude goes through a one-pole follower that rises
+//   with the attack time constant and falls with the release one, then
+//   (if a decay is set) through a peak hold: a new peak is held for the
+//   hold time, then falls by the decay rate until something louder comes
+//   along.  the filter runs in place over a magnitude array, one pass of
+//   selects with no branches, so it vectorizes and costs O(bins) a hop.
+//-----------------------------------------------------------------------------
+#ifndef __SMOOTH_H__
+#define __SMOOTH_H__
+
+
+//-----------------------------------------------------------------------------
+// name: struct SmoothParams
+// desc: filter settings; all zero passes magnitudes straight through
+//-----------------------------------------------------------------------------
+struct SmoothParams
+{
+    // follower time constants, ms (0 = follow at once)
+    float attack;
+    float release;
+    // peak hold time, ms, and fall rate after it, dB per second (0 = no
+    // peak hold)
+    float hold;
+    float decay;
+};
+
+//-----------------------------------------------------------------------------
+// name: struct Smooth
+// desc: per-hop coefficients and state, [channels][count]
+//-----------------------------------------------------------------------------
+struct Smooth
+{
+    unsigned int count;
+    unsigned int channels;
+    // follower gain per hop when rising and falling
+    float attack;
+    float release;
+    // hops to hold a peak, and the per-hop gain after that
+    float holdHops;
+    float decay;
+    bool peaks;
+    float * level;
+    float * peak;
+    // hops left to hold each peak
+    float * hold;
+};
+
+
+// "attack,release[,hold,decay]" into p; false if malformed
+bool smooth_params( const char * spec, SmoothParams * p );
+// do these params change anything
+bool smooth_enabled( const SmoothParams * p );
+// filter for `count` values per channel updated hopRate times a second
+Smooth * smooth_create( unsigned int count, unsigned int channels, float hopRate, const SmoothParams * p );
+void smooth_destroy( Smooth * s );
+// filter one channel's count magnitudes in place
+void smooth_apply( Smooth * s, unsigned int channel, float * mag );
+
+
+#endif
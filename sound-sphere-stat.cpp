@@ -0,0 +1,184 @@
+//-----------------------------------------------------------------------------
+// name: sound-sphere-stat.cpp
+// desc: print the health metrics a running sound-sphere publishes, or
+//       (with -f) the peak and descriptors of each channel in its latest
+//       published spectrum
+//
+//   usage: sound-sphere-stat [-w seconds] [-f] [segment name]
+//-----------------------------------------------------------------------------
+#include "metrics.h"
+#include "feed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: printHist()
+// desc: one line per histogram, scaled to a readable unit
+//-----------------------------------------------------------------------------
+static void printHist( const char * name, const MetricsHist & h, double scale, const char * unit )
+{
+    printf( "  %-9s n=%-10llu mean=%9.3f p50=%9.3f p90=%9.3f p99=%9.3f max=%9.3f %s\n",
+            name, (unsigned long long)h.count, h.mean * scale, h.p50 * scale,
+            h.p90 * scale, h.p99 * scale, h.max * scale, unit );
+}
+
+//-----------------------------------------------------------------------------
+// name: printBlock()
+// desc: dump a snapshot
+//-----------------------------------------------------------------------------
+static void printBlock( const MetricsBlock & m )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_REALTIME, &now );
+    double age = ( (double)now.tv_sec * 1e9 + now.tv_nsec - (double)m.updated ) / 1e9;
+    bool alive = kill( (pid_t)m.pid, 0 ) == 0;
+
+    printf( "sound-sphere pid %u%s, up %.0f s, updated %.1f s ago, %u Hz / %u frames\n",
+            m.pid, alive ? "" : " (not running)", m.uptime / 1e9, age,
+            m.sampleRate, m.bufferFrames );
+    printf( "  callbacks=%llu input overflows=%llu output underflows=%llu\n",
+            (unsigned long long)m.callbacks, (unsigned long long)m.overflows,
+            (unsigned long long)m.underflows );
+    printHist( "callback", m.callbackNs, 1e-3, "us" );
+    printHist( "interval", m.intervalNs, 1e-6, "ms" );
+    printHist( "jitter", m.jitterNs, 1e-3, "us" );
+    printHist( "latency", m.latencyFrames, 1.0, "frames" );
+    printHist( "frame", m.frameNs, 1e-6, "ms" );
+    printf( "  queue depth=%llu max=%llu\n",
+            (unsigned long long)m.queueDepth, (unsigned long long)m.queueMax );
+    printf( "  rss=%.1f MB peak=%.1f MB\n", m.rss / 1048576.0, m.peakRss / 1048576.0 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: printFeed()
+// desc: read the newest frame in place and report each channel's peak
+//-----------------------------------------------------------------------------
+static bool printFeed( const FeedHeader * h )
+{
+    uint64_t written = h->written.load( std::memory_order_acquire );
+    if( written == 0 )
+    {
+        printf( "no spectra published yet\n" );
+        return true;
+    }
+
+    uint64_t frame = written - 1;
+    const FeedSlot * slot = feed_slot( h, frame );
+    if( !feed_valid( slot, frame ) ) return false;
+
+    double time = slot->streamTime;
+    unsigned int peakBin[16];
+    float peak[16];
+    float desc[16][FEED_DESCRIPTORS];
+    unsigned int channels = h->channels < 16 ? h->channels : 16;
+    for( unsigned int c = 0; c < channels; c++ )
+    {
+        const float * mags = feed_data( h, slot, c );
+        peakBin[c] = 0;
+        peak[c] = 0;
+        for( unsigned int k = 1; k < h->bins; k++ )
+            if( mags[k] > peak[c] ) { peak[c] = mags[k]; peakBin[c] = k; }
+        memcpy( desc[c], feed_descriptors( h, slot, c ), sizeof(desc[c]) );
+    }
+    // overwritten while we looked: caller retries
+    if( !feed_valid( slot, frame ) ) return false;
+
+    printf( "frame %llu at %.3f s (fft %u, hop %u, %u Hz, %u ch)\n",
+            (unsigned long long)frame, time, h->fftSize, h->hop, h->sampleRate, h->channels );
+    for( unsigned int c = 0; c < channels; c++ )
+        printf( "  ch %-2u peak %8.1f Hz  %.4f  rms %.4f  centroid %7.1f Hz  rolloff %7.1f Hz"
+                "  flatness %.3f  flux %.2f\n", c,
+                (double)peakBin[c] * h->sampleRate / h->fftSize, peak[c],
+                desc[c][0], desc[c][2], desc[c][3], desc[c][4], desc[c][5] );
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: main()
+// desc: entry point
+//-----------------------------------------------------------------------------
+int main( int argc, char ** argv )
+{
+    const char * name = NULL;
+    int watch = 0;
+    bool spectrum = false;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        if( !strcmp( argv[i], "-w" ) && i + 1 < argc )
+            watch = atoi( argv[++i] );
+        else if( !strcmp( argv[i], "-f" ) )
+            spectrum = true;
+        else if( argv[i][0] == '-' )
+        {
+            fprintf( stderr, "usage: %s [-w seconds] [-f] [segment name]\n", argv[0] );
+            return 1;
+        }
+        else
+            name = argv[i];
+    }
+
+    if( spectrum )
+    {
+        if( !name ) name = FEED_SHM_NAME;
+        const FeedHeader * feed = feed_open( name );
+        if( !feed )
+        {
+            fprintf( stderr, "[sound-sphere-stat]: no spectra at %s (is sound-sphere running with --feed?)\n", name );
+            return 1;
+        }
+        do
+        {
+            while( !printFeed( feed ) ) ;
+            if( watch > 0 )
+            {
+                fflush( stdout );
+                sleep( watch );
+            }
+        } while( watch > 0 );
+        feed_close( feed );
+        return 0;
+    }
+
+    if( !name ) name = METRICS_SHM_NAME;
+    const MetricsBlock * shared = metrics_open( name );
+    if( !shared )
+    {
+        fprintf( stderr, "[sound-sphere-stat]: no metrics at %s (is sound-sphere running with --metrics?)\n", name );
+        return 1;
+    }
+
+    do
+    {
+        MetricsBlock m;
+        if( !metrics_read( shared, &m ) )
+        {
+            fprintf( stderr, "[sound-sphere-stat]: could not get a consistent snapshot\n" );
+            metrics_close( shared );
+            return 1;
+        }
+        printBlock( m );
+        if( watch > 0 )
+        {
+            printf( "\n" );
+            fflush( stdout );
+            sleep( watch );
+        }
+    } while( watch > 0 );
+
+    metrics_close( shared );
+    return 0;
+}
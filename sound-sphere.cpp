@@ -9,12 +9,30 @@
 #include "RtAudio.h"
 #include "chuck_fft.h"
 #include "color.h"
+#include "instrument.h"
+#include "metrics.h"
+#include "feed.h"
+#include "capture.h"
+#include "recorder.h"
+#include "analysis.h"
+#include "config.h"
+#include "colormap.h"
+#include "spectrogram.h"
+#include "lod.h"
+#include "bands.h"
+#include "cqt.h"
+#include "sdft.h"
 #include <math.h>
 #include <stdlib.h>
 #include <iostream>
 #include <cstring>
 #include <sys/time.h>
 #include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <algorithm>
 using namespace std;
 
 #ifdef __MACOSX_CORE__
@@ -45,16 +63,19 @@ void keyboardFunc( unsigned char, int, int );
 void specialFunc( int, int, int );
 void mouseFunc( int button, int state, int x, int y );
 void help();
+void statsSignal( int sig );
+void exitCleanup();
+void stopInput();
+void * replayThread( void * data );
+void initAnalysis( long fftSize, long hop );
+int runBench( const char * path, long frames );
+void benchIdleFunc();
 
 
 // our datetype
 #define SAMPLE float
 // corresponding format for RtAudio
 #define MY_FORMAT RTAUDIO_FLOAT32
-// sample rate
-#define MY_SRATE 44100
-// number of channels
-#define MY_CHANNELS 1
 // for convenience
 #define MY_PIE 3.14159265358979
 
@@ -65,17 +86,30 @@ long g_last_width = g_width;
 long g_last_height = g_height;
 // history length
 int g_histSize = 255;
+// spectrogram texture rows
+#define SPECTROGRAM_ROWS 256
 // refresh rate settings
 long time_pre = 0;
 int refresh_rate = 15000; //us
 struct timeval timer;
-// global buffer
-SAMPLE * g_buffer = NULL;
-SAMPLE * g_freq_buffer = NULL;
-complex * g_cbuff = NULL;
-complex ** g_cbuff_buff = NULL;
-SAMPLE * g_avg_buff = NULL;
+// stream and analysis settings (--config and friends)
+Config g_config;
+// sample rate of the stream or the replayed log
+unsigned int g_sampleRate = CONFIG_SRATE;
+// analysis (FFT) size
 long g_bufferSize;
+// samples between spectra (one period)
+long g_hopSize;
+// number of input channels
+int g_channels = CONFIG_CHANNELS;
+// spectrum analysis, fed by the callback
+Analysis * g_analysis = NULL;
+// analysis threads, 0 = one per core
+int g_analysisThreads = 1;
+// all-zero spectra, drawn in buggy mode when no new frame arrived
+complex * g_silence = NULL;
+// radial distance between channel rings
+float g_channelSpacing = 0.35f;
 // flags
 bool g_rotate = false;
 bool g_circle = false;
@@ -85,8 +119,45 @@ bool g_waterfall = false;
 bool g_party = false;
 bool g_noBug = true;
 bool g_avMax = false;
+bool g_binColor = false;
+// draw rings with the shader when OpenGL 2.0 is there ('g', --gpu-draw)
+bool g_gpuDraw = false;
+// scrolling spectrogram instead of rings ('o'), created on first use
+bool g_spectrogram = false;
+Spectrogram * g_spectrogramTex = NULL;
+// rings are decimated to at most this many vertices (set on reshape)
+long g_lodPoints = 4096;
+Lod g_lod = { 0, 0, NULL, NULL };
+// a ring ready to draw, prepared once a frame however often it is drawn:
+// the spectrum itself, or its copy reduced to the vertex budget, and with
+// 'v' on the CPU path, each vertex's color
+struct Ring
+{
+    const complex * bins;
+    long n;
+    // NULL unless colored per bin
+    const float * colors;
+    // [g_ringSize] and [3 * g_ringSize], owned
+    complex * reduced;
+    float * level;
+    float * rgb;
+};
+// one per channel ring, then one per sliding-dft ring
+Ring * g_rings = NULL;
+int g_ringSlots = 0;
+long g_ringSize = 0;
+// band map or cqt from --bands, and whether rings show them or bins ('l')
+BandMap * g_bands = NULL;
+Cqt * g_cqt = NULL;
+// sliding dft from --sdft, drawn as extra rings outside the others
+Sdft * g_sdft = NULL;
+// radius pulses with the beat and party colors flash on onsets ('t')
+bool g_beatSync = true;
+// party colors follow each channel's detected pitch class ('n')
+bool g_pitchColor = true;
+bool g_showBands = true;
 #ifdef __UNIX_JACK__
-GLboolean g_fullscreen = gl_FALSE;
+GLboolean g_fullscreen = GL_FALSE;
 #else
 GLboolean g_fullscreen = FALSE;
 #endif
@@ -94,15 +165,43 @@ GLboolean g_fullscreen = FALSE;
 float g_radius_factor = 1.0f;
 float g_radius = 1.0f;
 float g_radius_base = 1.0f;
-// window
+// window (owned by the analysis)
 SAMPLE * g_window = NULL;
-// history counter
-int g_histCount = 0;
-int g_maxCount = 0;
-// max val
-float g_maxVal = 0.0f;
 // left/right rotation
 float yrot = 3.0f;
+// vertices submitted since last reset (for benchmarking)
+long g_vertexCount = 0;
+// audio callback instrumentation
+Instrument g_instrument;
+// set by SIGUSR1, serviced in idleFunc()
+volatile sig_atomic_t g_dumpStats = 0;
+// ns spent rendering each frame (written by the GLUT thread only)
+Histogram g_frameTime;
+// most analysis hops seen queued by a frame
+uint64_t g_queueMax = 0;
+// shared-memory metrics (NULL unless --metrics)
+MetricsBlock * g_metrics = NULL;
+const char * g_metricsName = METRICS_SHM_NAME;
+uint64_t g_metricsLast = 0;
+// how often to publish metrics, ns
+#define METRICS_PERIOD 500000000ULL
+// shared-memory spectrum feed (NULL unless --feed)
+FeedHeader * g_feed = NULL;
+const char * g_feedName = FEED_SHM_NAME;
+// input capture log (NULL unless --capture)
+Capture * g_capture = NULL;
+// the open stream (NULL once closed, or when replaying)
+RtAudio * g_audio = NULL;
+// input replay (NULL unless --replay)
+Replay * g_replay = NULL;
+bool g_replayFast = false;
+std::atomic<bool> g_replayDone( false );
+// asks the replay thread to return early
+std::atomic<bool> g_replayStop( false );
+pthread_t g_replayThread;
+bool g_replayRunning = false;
+// raw audio archive (NULL unless --record)
+Recorder * g_recorder = NULL;
 
 
 
@@ -114,67 +213,104 @@ float yrot = 3.0f;
 int callme( void * outputBuffer, void * inputBuffer, unsigned int numFrames,
             double streamTime, RtAudioStreamStatus status, void * data )
 {
-    // cast!
+    // timestamp, count xruns
+    uint64_t start = inst_callback_begin( &g_instrument, status,
+                                          (uint64_t)numFrames * 1000000000ULL / g_sampleRate );
+    
+    // cast! (non-interleaved: one channel after another)
     SAMPLE * input = (SAMPLE *)inputBuffer;
     SAMPLE * output = (SAMPLE *)outputBuffer;
-    SAMPLE avg = 0.0f, sum = 0.0f;
-    
-    // fill
-    for( int i = 0; i < numFrames; i++ )
-    {
-        // assume mono
-        g_buffer[i] = input[i];
-        // zero output
-        output[i] = 0;
-    }
     
-    // apply window
-    apply_window(g_buffer, g_window, (unsigned long) g_bufferSize);
+    // log the raw input for later replay
+    if( g_capture )
+        capture_write( g_capture, input, numFrames, streamTime, status );
+    // archive it
+    if( g_recorder )
+        recorder_write( g_recorder, input, numFrames, g_channels );
     
-    // copy g_buffer to g_freq_buffer
-    memcpy( g_freq_buffer, g_buffer, sizeof(SAMPLE)*g_bufferSize);
+    // hand off to the analysis thread
+    analysis_push( g_analysis, input, numFrames );
     
-    // fft
-    rfft(g_freq_buffer, g_bufferSize/2, FFT_FORWARD);
+    // monitoring: pass the input straight through (NULL when input-only)
+    if( output )
+        memcpy( output, input, sizeof(SAMPLE) * numFrames * g_channels );
     
-    // Get the complex buffer for this round set up
-    g_cbuff = (complex *) g_freq_buffer;
+    // time spent and backend latency (snd_pcm_delay on ALSA)
+    RtAudio * audio = (RtAudio *)data;
+    inst_callback_end( &g_instrument, start, audio ? audio->getStreamLatency() : 0 );
     
-    g_maxVal = 0.0f; //reset maxVal
-    
-    // Store this complex buffer in the history buffer
-    // Indices are modulo g_histSize. This creates a rolling
-    // store of size g_histSize
-    for (int j = 0; j < g_bufferSize/2; j++) {
-        g_cbuff_buff[g_histCount][j].re = 0;
-        g_cbuff_buff[g_histCount][j].im = 0;
-        g_cbuff_buff[g_histCount][j] = g_cbuff[j];
-        
-        // get new maxVal
-        if (cmp_abs(g_cbuff[j]) > g_maxVal) {
-            g_maxVal = cmp_abs(g_cbuff[j]);
-            g_avg_buff[g_histCount] = g_maxVal;
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name: prepareRing( )
+// Desc: ring `slot` for this frame: no more vertices than the screen can
+//       show, keeping the peaks, colored by magnitude if asked
+//-----------------------------------------------------------------------------
+const Ring & prepareRing(int slot, const complex * cbuff, long n) {
+    // sized between frames only (reshape, channel count), so rings
+    // prepared earlier in a frame stay valid
+    if (g_ringSlots < 2 * g_channels || g_ringSize < g_lodPoints) {
+        for (int i = 0; i < g_ringSlots; i++) {
+            delete [] g_rings[i].reduced;
+            delete [] g_rings[i].level;
+            delete [] g_rings[i].rgb;
+        }
+        delete [] g_rings;
+        g_ringSlots = 2 * g_channels;
+        g_ringSize = g_lodPoints;
+        g_rings = new Ring[g_ringSlots];
+        for (int i = 0; i < g_ringSlots; i++) {
+            g_rings[i].reduced = new complex[g_ringSize];
+            g_rings[i].level = new float[g_ringSize];
+            g_rings[i].rgb = new float[3*g_ringSize];
         }
     }
     
-    g_histCount = (g_histCount + 1) % g_histSize;
-    if ( g_histCount > g_maxCount ) g_maxCount = g_histCount;
+    Ring & ring = g_rings[slot];
+    ring.bins = cbuff;
+    ring.n = n;
+    if (n > g_lodPoints) {
+        if (g_lod.bins != n) lod_plan(&g_lod, n, g_lodPoints);
+        memcpy(ring.reduced, lod_apply(&g_lod, cbuff), sizeof(complex) * g_lod.points);
+        ring.bins = ring.reduced;
+        ring.n = g_lod.points;
+    }
     
-    return 0;
+    // per-bin colors: each vertex colored by its magnitude, all at once
+    // (the shader colors its own)
+    ring.colors = NULL;
+    if (g_binColor && !(g_gpuDraw && colormap_ready())) {
+        for (long i = 0; i < ring.n; i++)
+            ring.level[i] = sqrt(cmp_abs(ring.bins[i]));
+        colorSpectrumBatch(ring.level, ring.rgb, ring.n);
+        ring.colors = ring.rgb;
+    }
+    return ring;
 }
 
 //-----------------------------------------------------------------------------
 // Name: drawCircle( )
 // Desc: draws a circle
 //-----------------------------------------------------------------------------
-void drawCircle(complex * cbuff) {
+void drawCircle(const Ring & ring, float offset) {
     float radius, angle, x, y, xrot = 0.0f, zrot = 0.0f;
+    const complex * cbuff = ring.bins;
+    long n = ring.n;
+    
+    // geometry and colormap on the GPU, straight from the spectrum
+    if (g_gpuDraw && colormap_ready()) {
+        radius = g_radius_factor * g_radius + g_radius_base + offset;
+        colormap_ring(cbuff, n, radius, g_binColor);
+        g_vertexCount += n;
+        return;
+    }
     
     glBegin(GL_LINE_LOOP);
     
-    for(int i =0; i < (g_bufferSize/2); i++){
-        angle = 2 * M_PI * i / (g_bufferSize/2);
-        radius = g_radius_factor * g_radius + g_radius_base;
+    for(int i =0; i < n; i++){
+        angle = 2 * M_PI * i / n;
+        radius = g_radius_factor * g_radius + g_radius_base + offset;
         
         if (cmp_abs(cbuff[i]) <= 1) {
             x = (10*pow(cmp_abs(cbuff[i]), .5)+radius)*cos(angle);
@@ -184,10 +320,12 @@ void drawCircle(complex * cbuff) {
             y = radius*sin(angle);
         }
         
+        if (ring.colors) glColor3fv(ring.colors + 3*i);
         glVertex2f(x,y);
     }
 
     glEnd();
+    g_vertexCount += n;
 }
 
 //-----------------------------------------------------------------------------
@@ -221,6 +359,7 @@ void drawWindow() {
         x += xinc;
     }
     glEnd();
+    g_vertexCount += g_bufferSize;
 }
 
 //-----------------------------------------------------------------------------
@@ -246,7 +385,14 @@ void help()
     cerr << "'p' - toggle party mode" << endl;
     cerr << "'a' - toggle max averaging in party mode. Makes color change more smoothly." << endl;
     cerr << "'b' - toggle buggy...er...awesome mode" << endl;
+    cerr << "'v' - toggle coloring each bin by its magnitude" << endl;
+    cerr << "'g' - toggle drawing the rings with a shader (OpenGL 2.0)" << endl;
+    cerr << "'o' - toggle the scrolling spectrogram (replaces rings and sphere)" << endl;
+    cerr << "'l' - toggle drawing bands instead of bins (with --bands)" << endl;
+    cerr << "'t' - toggle beat-synced radius and party colors" << endl;
+    cerr << "'n' - toggle coloring rings by detected pitch in party mode" << endl;
     cerr << "'r' - toggle rotation" << endl;
+    cerr << "'i' - print audio callback stats (also on SIGUSR1)" << endl;
     cerr << endl;
     cerr << "radius controls:" << endl;
     cerr << "Press or hold the up and down keys to increase or " << endl;
@@ -257,6 +403,60 @@ void help()
     cerr << "----------------------------------------------------" << endl;
 }
 
+//-----------------------------------------------------------------------------
+// Name: statsSignal( )
+// Desc: SIGUSR1 handler, defers the stats dump to the GLUT thread
+//-----------------------------------------------------------------------------
+void statsSignal( int sig )
+{
+    g_dumpStats = 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name: stopInput( )
+// Desc: close the stream (or end the replay) and join the analysis, so
+//       nothing writes to the logs or the segments after this returns
+//-----------------------------------------------------------------------------
+void stopInput()
+{
+    if( g_audio && g_audio->isStreamOpen() )
+    {
+        try { g_audio->closeStream(); }
+        catch( RtError & e ) { cerr << e.getMessage() << endl; }
+    }
+    g_audio = NULL;
+    if( g_replayRunning )
+    {
+        g_replayStop.store( true, std::memory_order_release );
+        pthread_join( g_replayThread, NULL );
+        g_replayRunning = false;
+    }
+    if( g_analysis )
+        analysis_stop( g_analysis );
+}
+
+//-----------------------------------------------------------------------------
+// Name: exitCleanup( )
+// Desc: finish the capture log and recording, remove the shared-memory
+//       segments; 'q' exits with everything still running, so stop the
+//       input first
+//-----------------------------------------------------------------------------
+void exitCleanup()
+{
+    stopInput();
+    // nothing can reach the capture once the pointer is cleared
+    Capture * capture = g_capture;
+    g_capture = NULL;
+    capture_stop( capture );
+    Recorder * recorder = g_recorder;
+    g_recorder = NULL;
+    recorder_stop( recorder );
+    metrics_destroy( g_metrics, g_metricsName );
+    g_metrics = NULL;
+    feed_destroy( g_feed, g_feedName );
+    g_feed = NULL;
+}
+
 
 
 //-----------------------------------------------------------------------------
@@ -265,15 +465,100 @@ void help()
 //-----------------------------------------------------------------------------
 int main( int argc, char ** argv )
 {
-    // instantiate RtAudio object
-    RtAudio audio;
-    // variables
-    unsigned int bufferBytes = 0;
     // frame size
-    unsigned int bufferFrames = 512;
+    unsigned int bufferFrames = 0;
+    // just print the devices
+    bool listDevices = false;
+    // benchmark settings
+    const char * benchFile = NULL;
+    long benchFrames = 300;
+    // publish metrics to shared memory
+    bool metrics = false;
+    // publish spectra to shared memory
+    bool feed = false;
+    // input capture/replay logs
+    const char * captureFile = NULL;
+    const char * replayFile = NULL;
+    // raw recording
+    const char * recordFile = NULL;
+    
+    // parse command line; stream settings may also come from --config
+    config_defaults( &g_config );
+    for( int i = 1; i < argc; i++ )
+    {
+        int result = config_args( &g_config, argc, argv, &i );
+        if( result < 0 )
+            exit( 1 );
+        else if( result > 0 )
+            continue;
+        else if( !strcmp( argv[i], "--list-devices" ) )
+            listDevices = true;
+        else if( !strcmp( argv[i], "--gpu-draw" ) )
+            g_gpuDraw = true;
+        else if( !strcmp( argv[i], "--bench" ) && i + 1 < argc )
+            benchFile = argv[++i];
+        else if( !strcmp( argv[i], "--bench-frames" ) && i + 1 < argc )
+            benchFrames = atol( argv[++i] );
+        else if( !strcmp( argv[i], "--metrics" ) )
+            metrics = true;
+        else if( !strcmp( argv[i], "--metrics-name" ) && i + 1 < argc )
+            g_metricsName = argv[++i];
+        else if( !strcmp( argv[i], "--feed" ) )
+            feed = true;
+        else if( !strcmp( argv[i], "--feed-name" ) && i + 1 < argc )
+            g_feedName = argv[++i];
+        else if( !strcmp( argv[i], "--capture" ) && i + 1 < argc )
+            captureFile = argv[++i];
+        else if( !strcmp( argv[i], "--replay" ) && i + 1 < argc )
+            replayFile = argv[++i];
+        else if( !strcmp( argv[i], "--replay-fast" ) )
+            g_replayFast = true;
+        else if( !strcmp( argv[i], "--record" ) && i + 1 < argc )
+            recordFile = argv[++i];
+        else if( !strcmp( argv[i], "--analysis-threads" ) && i + 1 < argc )
+            g_analysisThreads = atoi( argv[++i] );
+    }
+    
+    g_channels = g_config.channels;
+    g_sampleRate = g_config.sampleRate;
+    bufferFrames = g_config.bufferFrames;
+    
+    // headless benchmark: no audio device needed
+    if( benchFile )
+    {
+        glutInit( &argc, argv );
+        initGfx();
+        g_bufferSize = config_fft_size( &g_config, bufferFrames );
+        g_hopSize = bufferFrames;
+        return runBench( benchFile, benchFrames );
+    }
+    
+    // replay a capture log instead of opening a device
+    if( replayFile )
+    {
+        g_replay = replay_open( replayFile );
+        if( !g_replay )
+        {
+            cerr << "[sound-sphere]: cannot read capture log " << replayFile << endl;
+            exit( 1 );
+        }
+        g_channels = g_replay->header.channels;
+        g_sampleRate = g_replay->header.sampleRate;
+        bufferFrames = g_replay->header.bufferFrames;
+    }
+    
+    // instantiate RtAudio object
+    RtAudio audio( g_config.api );
+    g_audio = &audio;
+    
+    if( listDevices )
+    {
+        config_list_devices( audio );
+        exit( 0 );
+    }
     
     // check for audio devices
-    if( audio.getDeviceCount() < 1 )
+    if( !g_replay && audio.getDeviceCount() < 1 )
     {
         // nopes
         cout << "no audio devices found!" << endl;
@@ -284,67 +569,146 @@ int main( int argc, char ** argv )
     glutInit( &argc, argv );
     // init gfx
     initGfx();
+    
+    // cpus the callback thread was actually pinned to, if any
+    unsigned long long callbackCpus = 0;
 
-    // let RtAudio print messages to stderr.
-    audio.showWarnings( true );
+    if( !g_replay )
+    {
+        // let RtAudio print messages to stderr.
+        audio.showWarnings( true );
 
-    // set input and output parameters
-    RtAudio::StreamParameters iParams, oParams;
-    iParams.deviceId = audio.getDefaultInputDevice();
-    iParams.nChannels = MY_CHANNELS;
-    iParams.firstChannel = 0;
-    oParams.deviceId = audio.getDefaultOutputDevice();
-    oParams.nChannels = MY_CHANNELS;
-    oParams.firstChannel = 0;
+        // set input and output parameters; the output is only opened
+        // when monitoring, otherwise the stream is input-only
+        int inputDevice = config_device( audio, &g_config, true );
+        int outputDevice = g_config.monitor ? config_device( audio, &g_config, false ) : 0;
+        if( inputDevice < 0 || outputDevice < 0 )
+            exit( 1 );
+        RtAudio::StreamParameters iParams, oParams;
+        iParams.deviceId = inputDevice;
+        iParams.nChannels = g_channels;
+        iParams.firstChannel = 0;
+        oParams.deviceId = outputDevice;
+        oParams.nChannels = g_channels;
+        oParams.firstChannel = 0;
     
-    // create stream options
-    RtAudio::StreamOptions options;
+        // create stream options; channels arrive one after another, so
+        // the analysis can take each one without deinterleaving
+        RtAudio::StreamOptions options;
+        config_options( &g_config, &options );
+        options.flags |= RTAUDIO_NONINTERLEAVED;
 
-    // go for it
-    try {
-        // open a stream
-        audio.openStream( &oParams, &iParams, MY_FORMAT, MY_SRATE, &bufferFrames, &callme, (void *)&bufferBytes, &options );
+        // go for it
+        try {
+            // open a stream
+            audio.openStream( g_config.monitor ? &oParams : NULL, &iParams, MY_FORMAT, g_sampleRate, &bufferFrames, &callme, (void *)&audio, &options );
+        }
+        catch( RtError& e )
+        {
+            // error!
+            cout << e.getMessage() << endl;
+            exit( 1 );
+        }
+        
+        // the api may round the period size and pick the period count
+        cerr << "[sound-sphere]: " << config_api_name( audio.getCurrentApi() ) << ", "
+             << g_sampleRate << " Hz, " << bufferFrames << " frames x "
+             << options.numberOfBuffers << " periods, " << g_channels << " channel(s)"
+             << ( g_config.monitor ? ", monitoring" : ", input only" ) << endl;
+
+        // the poll loop and the wakeup timer are alsa's own
+        if( ( g_config.alsaPoll || g_config.wakeupFrames ) && audio.getCurrentApi() != RtAudio::LINUX_ALSA )
+            cerr << "[sound-sphere]: --alsa-poll and --wakeup-frames only apply to alsa, not "
+                 << config_api_name( audio.getCurrentApi() ) << " (try --api alsa)" << endl;
+
+        // what the callback thread actually got; jack and core run the
+        // callback on their own thread, so only memory locking applies
+        if( g_config.realtime || g_config.cpuAffinity || g_config.lockMemory )
+        {
+            const RtAudio::RealtimeReport & rt = options.applied;
+            cerr << "[sound-sphere]: callback thread ";
+            if( rt.policy < 0 )
+                cerr << "owned by " << config_api_name( audio.getCurrentApi() );
+            else
+                cerr << ( rt.policy == SCHED_FIFO ? "fifo" : rt.policy == SCHED_RR ? "rr" : "other" )
+                     << " priority " << rt.priority << ", cpus 0x" << hex << rt.cpuAffinity << dec;
+            cerr << ( rt.memoryLocked ? ", memory locked" : "" )
+                 << ( rt.fallback ? " (fell back: not permitted)" : "" ) << endl;
+        }
+
+        // only a thread of RtAudio's own that kept the requested cpus
+        const RtAudio::RealtimeReport & rt = options.applied;
+        if( g_config.cpuAffinity && rt.policy >= 0 && rt.cpuAffinity &&
+            !( rt.cpuAffinity & ~g_config.cpuAffinity ) )
+            callbackCpus = rt.cpuAffinity;
     }
-    catch( RtError& e )
+
+    // one spectrum per buffer, over fftSize samples
+    initAnalysis( config_fft_size( &g_config, bufferFrames ), bufferFrames );
+    
+    // reset instrumentation, dump it on SIGUSR1
+    inst_clear( &g_instrument );
+    hist_clear( &g_frameTime );
+    signal( SIGUSR1, statsSignal );
+    
+    // export metrics for external monitoring
+    if( metrics )
     {
-        // error!
-        cout << e.getMessage() << endl;
-        exit( 1 );
+        g_metrics = metrics_create( g_metricsName, g_sampleRate, bufferFrames );
+        if( !g_metrics )
+            cerr << "[sound-sphere]: cannot create metrics segment " << g_metricsName << endl;
     }
-
-    // compute
-    bufferBytes = bufferFrames * MY_CHANNELS * sizeof(SAMPLE);
-    // allocate global buffer
-    g_bufferSize = bufferFrames;
-    g_buffer = new SAMPLE[g_bufferSize];
-    g_freq_buffer = new SAMPLE[g_bufferSize];
-    memset( g_buffer, 0, sizeof(SAMPLE)*g_bufferSize );
-    memset(g_freq_buffer, 0, sizeof(SAMPLE)*g_bufferSize);
-    g_window = new SAMPLE[g_bufferSize];
-    g_avg_buff = new SAMPLE[g_histSize];
-    
-    g_cbuff = new complex [g_bufferSize/2];
-    for (int i = 0; i < (g_bufferSize/2); i++) {
-        g_cbuff[i].re = 0.0f;
-        g_cbuff[i].im = 0.0f;
-    }
-    
-    g_cbuff_buff = new complex *[g_histSize];
-    for (int i = 0; i < g_histSize; i++){
-        g_cbuff_buff[i] = new complex [g_bufferSize/2];
-        for (int j= 0; j < (g_bufferSize/2); j++) {
-            g_cbuff_buff[i][j].re = 0;
-            g_cbuff_buff[i][j].re = 0;
-        }
+    
+    // export spectra for other processes
+    if( feed )
+    {
+        g_feed = feed_create( g_feedName, g_bufferSize, bufferFrames, g_sampleRate, g_channels, FEED_SLOTS );
+        if( g_feed )
+            analysis_set_feed( g_analysis, g_feed );
+        else
+            cerr << "[sound-sphere]: cannot create spectrum feed " << g_feedName << endl;
     }
     
-
+    // log the input for replay
+    if( captureFile )
+    {
+        g_capture = capture_start( captureFile, g_sampleRate, g_channels, bufferFrames );
+        if( !g_capture )
+            cerr << "[sound-sphere]: cannot write capture log " << captureFile << endl;
+    }
     
-    hanning(g_window, (unsigned long)g_bufferSize);
+    // archive the input
+    if( recordFile )
+    {
+        g_recorder = recorder_start( recordFile, g_channels );
+        if( !g_recorder )
+            cerr << "[sound-sphere]: cannot record to " << recordFile << endl;
+    }
+    
+    // flush the logs and remove the segments on exit
+    if( g_metrics || g_feed || g_capture || g_recorder )
+        atexit( exitCleanup );
     
     // print help
     help();
     
+    // spectra are computed off the audio thread, and off its cpus
+    if( callbackCpus )
+        analysis_avoid_cpus( g_analysis, callbackCpus );
+    if( g_analysisThreads != 1 )
+        cerr << "[sound-sphere]: analysis on "
+             << analysis_set_workers( g_analysis, g_analysisThreads < 0 ? 1 : g_analysisThreads )
+             << " threads" << endl;
+    analysis_start( g_analysis );
+    
+    // drive the pipeline from the log
+    if( g_replay )
+    {
+        g_replayRunning = !pthread_create( &g_replayThread, NULL, replayThread, NULL );
+        glutMainLoop();
+        return 0;
+    }
+    
     // go for it
     try {
         // start stream
@@ -367,8 +731,13 @@ cleanup:
     // close if open
     if( audio.isStreamOpen() )
         audio.closeStream();
+    g_audio = NULL;
     
-    delete g_buffer, g_cbuff, g_window, g_freq_buffer, g_cbuff_buff;
+    analysis_destroy( g_analysis );
+    g_analysis = NULL;
+    bands_destroy( g_bands );
+    cqt_destroy( g_cqt );
+    sdft_destroy( g_sdft );
     
     // done
     return 0;
@@ -377,6 +746,377 @@ cleanup:
 
 
 
+//-----------------------------------------------------------------------------
+// name: initAnalysis()
+// desc: set up the analysis for g_channels channels
+//-----------------------------------------------------------------------------
+void initAnalysis( long fftSize, long hop )
+{
+    g_bufferSize = fftSize;
+    g_hopSize = hop;
+    g_analysis = analysis_create( g_channels, fftSize, hop, g_sampleRate, g_histSize );
+    if( !g_analysis )
+    {
+        cerr << "[sound-sphere]: fft size " << fftSize << " is not a power of two" << endl;
+        exit( 1 );
+    }
+    g_window = g_analysis->window;
+    analysis_set_precision( g_analysis, g_config.fftPrecision );
+    
+    // constant-Q bins, on their own longer windows
+    if( g_config.bands == BANDS_CQT )
+    {
+        g_cqt = cqt_create( g_config.cqtFmin, g_config.cqtOctaves, CQT_BINS_PER_OCTAVE, g_sampleRate );
+        if( g_cqt )
+        {
+            analysis_set_cqt( g_analysis, g_cqt );
+            cerr << "[sound-sphere]: " << g_cqt->bins << " cqt bins from " << g_cqt->fmin
+                 << " Hz, " << g_cqt->fftSize << "-point window" << endl;
+        }
+        else
+            cerr << "[sound-sphere]: no cqt bins fit below Nyquist" << endl;
+    }
+    // bands are computed with the spectra; never more bands than bins
+    else if( g_config.bands != BANDS_NONE )
+    {
+        unsigned int count = g_config.bandCount < (unsigned int)( g_bufferSize/2 )
+                           ? g_config.bandCount : (unsigned int)( g_bufferSize/2 );
+        g_bands = bands_create( g_config.bands, count, g_bufferSize, g_sampleRate );
+        analysis_set_bands( g_analysis, g_bands );
+        cerr << "[sound-sphere]: " << count << " " << bands_name( g_config.bands )
+             << " bands from " << BANDS_FMIN << " Hz" << endl;
+    }
+    
+    // how far the transforms are from exact, measured once
+    cerr << "[sound-sphere]: " << fft_precision_name( g_config.fftPrecision )
+         << " precision fft, rms error " << fft_plan_error( g_analysis->plan );
+    if( g_analysis->cqtPlan )
+        cerr << " (" << fft_plan_error( g_analysis->cqtPlan ) << " at the cqt's "
+             << g_analysis->cqt->fftSize << " points)";
+    cerr << endl;
+    
+    // per-sample spectrum of a few bins, same window
+    if( g_config.sdftBins[0] )
+    {
+        unsigned int bins[SDFT_MAX_BINS];
+        int count = sdft_bins( g_config.sdftBins, bins, SDFT_MAX_BINS );
+        g_sdft = sdft_create( g_bufferSize, bins, count, g_channels );
+        if( g_sdft )
+        {
+            analysis_set_sdft( g_analysis, g_sdft );
+            cerr << "[sound-sphere]: sliding dft over " << g_sdft->bins << " bin(s)" << endl;
+        }
+        else
+            cerr << "[sound-sphere]: no --sdft bins below " << g_bufferSize/2 << endl;
+    }
+    
+    // smoothing per view, over what it draws
+    if( smooth_enabled( &g_config.smoothRings ) )
+        analysis_set_smooth( g_analysis, ANALYSIS_VIEW_RINGS, &g_config.smoothRings );
+    if( smooth_enabled( &g_config.smoothSpectrogram ) )
+        analysis_set_smooth( g_analysis, ANALYSIS_VIEW_SPECTROGRAM, &g_config.smoothSpectrogram );
+    
+    // big enough for bins or bands
+    long silence = g_channels * std::max( g_bufferSize/2, (long)g_analysis->bandCount );
+    g_silence = new complex[silence];
+    memset( g_silence, 0, sizeof(complex) * silence );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: replayThread()
+// desc: feed the callback from a capture log with the recorded buffer
+//       boundaries, paced by the recorded stream times unless --replay-fast
+//-----------------------------------------------------------------------------
+void * replayThread( void * data )
+{
+    unsigned int samples = g_replay->header.bufferFrames * g_replay->header.channels;
+    SAMPLE * input = new SAMPLE[samples];
+    CaptureRecord record;
+    double first = -1.0;
+    uint64_t start = inst_now();
+    
+    while( !g_replayStop.load( std::memory_order_acquire ) && replay_next( g_replay, input, &record ) )
+    {
+        if( first < 0 ) first = record.streamTime;
+        if( !g_replayFast )
+        {
+            uint64_t target = start + (uint64_t)( ( record.streamTime - first ) * 1e9 );
+            uint64_t now = inst_now();
+            if( target > now )
+            {
+                struct timespec wait = { (time_t)( ( target - now ) / 1000000000ULL ),
+                                         (long)( ( target - now ) % 1000000000ULL ) };
+                nanosleep( &wait, NULL );
+            }
+        }
+        callme( NULL, input, record.frames, record.streamTime, record.status, NULL );
+    }
+    
+    delete [] input;
+    g_replayDone.store( true, std::memory_order_release );
+    return NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// benchmark state
+//-----------------------------------------------------------------------------
+// mode flags toggled by the benchmark, in keyboardFunc() order
+enum { BENCH_CIRCLE = 1, BENCH_SPHERE = 2, BENCH_WATERFALL = 4,
+       BENCH_WINDOW = 8, BENCH_PARTY = 16, BENCH_BUGGY = 32, BENCH_ALL = 64 };
+// frames to render (and discard) before timing each mode
+#define BENCH_WARMUP 10
+
+SAMPLE * g_benchAudio = NULL;
+long g_benchLength = 0;
+long g_benchPos = 0;
+long g_benchFrames = 0;
+int g_benchMode = 0;
+long g_benchFrame = 0;
+SAMPLE * g_benchIn = NULL;
+double * g_benchWall = NULL;
+double g_benchCpu = 0.0;
+long g_benchVerts = 0;
+
+//-----------------------------------------------------------------------------
+// name: nowUs()
+// desc: clock readings in microseconds
+//-----------------------------------------------------------------------------
+static double nowUs( clockid_t clock )
+{
+    struct timespec ts;
+    clock_gettime( clock, &ts );
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+//-----------------------------------------------------------------------------
+// name: loadAudio()
+// desc: load the first channel of a PCM16/float32 WAV file, or headerless
+//       float32 mono if there is no RIFF header
+//-----------------------------------------------------------------------------
+static SAMPLE * loadAudio( const char * path, long * length )
+{
+    FILE * f = fopen( path, "rb" );
+    if( !f ) return NULL;
+    
+    fseek( f, 0, SEEK_END );
+    long size = ftell( f );
+    fseek( f, 0, SEEK_SET );
+    unsigned char * bytes = new unsigned char[size];
+    size = (long)fread( bytes, 1, size, f );
+    fclose( f );
+    
+    unsigned char * data = bytes;
+    long dataSize = size;
+    int format = 3, channels = 1, bits = 32;
+    if( size >= 12 && !memcmp( bytes, "RIFF", 4 ) && !memcmp( bytes + 8, "WAVE", 4 ) )
+    {
+        // walk the chunks for "fmt " and "data"
+        dataSize = 0;
+        long pos = 12;
+        while( pos + 8 <= size )
+        {
+            unsigned int len = bytes[pos+4] | bytes[pos+5] << 8 | bytes[pos+6] << 16 | bytes[pos+7] << 24;
+            if( !memcmp( bytes + pos, "fmt ", 4 ) && pos + 24 <= size )
+            {
+                format = bytes[pos+8] | bytes[pos+9] << 8;
+                channels = bytes[pos+10] | bytes[pos+11] << 8;
+                bits = bytes[pos+22] | bytes[pos+23] << 8;
+            }
+            else if( !memcmp( bytes + pos, "data", 4 ) )
+            {
+                data = bytes + pos + 8;
+                dataSize = std::min( (long)len, size - pos - 8 );
+                break;
+            }
+            pos += 8 + len + (len & 1);
+        }
+        // WAVE_FORMAT_EXTENSIBLE: trust the bit depth
+        if( format == 0xFFFE ) format = bits == 32 ? 3 : 1;
+    }
+    
+    if( channels < 1 || !( ( format == 1 && bits == 16 ) || ( format == 3 && bits == 32 ) ) )
+    {
+        cerr << "[sound-sphere]: unsupported audio format in " << path << endl;
+        delete [] bytes;
+        return NULL;
+    }
+    
+    long frameBytes = channels * bits / 8;
+    *length = dataSize / frameBytes;
+    SAMPLE * samples = new SAMPLE[*length];
+    for( long i = 0; i < *length; i++ )
+    {
+        unsigned char * p = data + i * frameBytes;
+        if( format == 1 )
+        {
+            short s;
+            memcpy( &s, p, sizeof(short) );
+            samples[i] = s / 32768.0f;
+        }
+        else
+            memcpy( &samples[i], p, sizeof(float) );
+    }
+    
+    delete [] bytes;
+    return samples;
+}
+
+//-----------------------------------------------------------------------------
+// name: benchModeName()
+// desc: readable name for a benchmark mode combination
+//-----------------------------------------------------------------------------
+static string benchModeName( int mode )
+{
+    static const char * names[] = { "circle", "sphere", "waterfall", "window", "party", "buggy" };
+    string name;
+    for( int i = 0; i < 6; i++ )
+    {
+        if( !( mode & (1 << i) ) ) continue;
+        if( !name.empty() ) name += "+";
+        name += names[i];
+    }
+    return name.empty() ? "waveform" : name;
+}
+
+//-----------------------------------------------------------------------------
+// name: benchSetMode()
+// desc: apply a mode combination to the display flags
+//-----------------------------------------------------------------------------
+static void benchSetMode( int mode )
+{
+    g_circle = ( mode & BENCH_CIRCLE ) != 0;
+    g_sphere = ( mode & BENCH_SPHERE ) != 0;
+    g_waterfall = ( mode & BENCH_WATERFALL ) != 0;
+    g_window_on = ( mode & BENCH_WINDOW ) != 0;
+    g_party = ( mode & BENCH_PARTY ) != 0;
+    g_noBug = !( mode & BENCH_BUGGY );
+}
+
+//-----------------------------------------------------------------------------
+// name: benchNextMode()
+// desc: advance to the next reachable combination ('s' always turns the
+//       circle on, so sphere without circle is skipped)
+//-----------------------------------------------------------------------------
+static int benchNextMode( int mode )
+{
+    do mode++;
+    while( mode < BENCH_ALL && ( mode & BENCH_SPHERE ) && !( mode & BENCH_CIRCLE ) );
+    return mode;
+}
+
+//-----------------------------------------------------------------------------
+// name: benchFeed()
+// desc: push the next buffer of the file through the audio callback
+//-----------------------------------------------------------------------------
+static void benchFeed()
+{
+    if( g_benchPos + g_hopSize > g_benchLength ) g_benchPos = 0;
+    // same audio on every channel
+    for( int c = 0; c < g_channels; c++ )
+        memcpy( g_benchIn + c * g_hopSize, g_benchAudio + g_benchPos, sizeof(SAMPLE) * g_hopSize );
+    callme( NULL, g_benchIn, g_hopSize, (double)g_benchPos / g_sampleRate, 0, NULL );
+    g_benchPos += g_hopSize;
+    // analyze synchronously so every frame sees its own spectrum
+    analysis_process( g_analysis );
+}
+
+//-----------------------------------------------------------------------------
+// name: runBench()
+// desc: set up the headless render benchmark and hand control to GLUT
+//-----------------------------------------------------------------------------
+int runBench( const char * path, long frames )
+{
+    g_benchAudio = loadAudio( path, &g_benchLength );
+    if( !g_benchAudio || g_benchLength < g_bufferSize )
+    {
+        cerr << "[sound-sphere]: cannot read benchmark audio from " << path << endl;
+        return 1;
+    }
+    
+    initAnalysis( g_bufferSize, g_hopSize );
+    g_benchIn = new SAMPLE[g_hopSize * g_channels];
+    g_benchFrames = frames > 0 ? frames : 1;
+    g_benchWall = new double[g_benchFrames];
+    
+    // no frame pacing; GLUT never shows the window
+    refresh_rate = 0;
+    glutHideWindow();
+    reshapeFunc( g_width, g_height );
+    
+    // fill the spectrum history so waterfall draws all of it
+    for( int i = 0; i < g_histSize; i++ )
+        benchFeed();
+    
+    cout << "# sound-sphere render benchmark: " << path << ", "
+         << g_benchFrames << " frames/mode, " << g_hopSize << " frames/buffer, fft " << g_bufferSize << ", "
+         << g_channels << " channel(s)" << endl;
+    cout << "# mode                                 cpu_us/frame   p50_ms   p99_ms  verts/frame  60fps" << endl;
+    
+    g_benchMode = 0;
+    g_benchFrame = -BENCH_WARMUP;
+    benchSetMode( g_benchMode );
+    glutIdleFunc( benchIdleFunc );
+    glutMainLoop();
+    
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// name: benchIdleFunc()
+// desc: render one timed frame per idle call, report after each mode
+//-----------------------------------------------------------------------------
+void benchIdleFunc()
+{
+    benchFeed();
+    
+    g_vertexCount = 0;
+    double cpu = nowUs( CLOCK_THREAD_CPUTIME_ID );
+    double wall = nowUs( CLOCK_MONOTONIC );
+    displayFunc();
+    // wait for the GL to actually finish the frame
+    glFinish();
+    wall = nowUs( CLOCK_MONOTONIC ) - wall;
+    cpu = nowUs( CLOCK_THREAD_CPUTIME_ID ) - cpu;
+    
+    if( g_benchFrame >= 0 )
+    {
+        g_benchWall[g_benchFrame] = wall;
+        g_benchCpu += cpu;
+        g_benchVerts += g_vertexCount;
+    }
+    
+    if( ++g_benchFrame < g_benchFrames )
+        return;
+    
+    // report this mode
+    sort( g_benchWall, g_benchWall + g_benchFrames );
+    double p50 = g_benchWall[(g_benchFrames - 1) / 2] / 1000.0;
+    double p99 = g_benchWall[(long)( (g_benchFrames - 1) * 0.99 )] / 1000.0;
+    char line[160];
+    snprintf( line, sizeof(line), "%-38s %12.1f %8.3f %8.3f %12ld  %s",
+              benchModeName( g_benchMode ).c_str(), g_benchCpu / g_benchFrames,
+              p50, p99, g_benchVerts / g_benchFrames, p99 < 1000.0 / 60 ? "yes" : "no" );
+    cout << line << endl;
+    
+    g_benchMode = benchNextMode( g_benchMode );
+    if( g_benchMode >= BENCH_ALL )
+        exit( 0 );
+    
+    benchSetMode( g_benchMode );
+    g_benchFrame = -BENCH_WARMUP;
+    g_benchCpu = 0.0;
+    g_benchVerts = 0;
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // Name: reshapeFunc( )
 // Desc: called when window size changes
@@ -411,6 +1151,9 @@ void initGfx()
     glEnable( GL_COLOR_MATERIAL );
     // enable depth test
     glEnable( GL_DEPTH_TEST );
+    
+    // shader for the spectrum rings, if the GL has them
+    colormap_init();
 }
 
 
@@ -424,6 +1167,11 @@ void reshapeFunc( GLsizei w, GLsizei h )
 {
     // save the new window size
     g_width = w; g_height = h;
+    // ring vertex budget: a ring can't cover more pixels than the window's
+    // perimeter, so larger ffts are decimated to it
+    g_lodPoints = 2 * ( w + h );
+    if( g_bufferSize > 0 )
+        lod_plan( &g_lod, g_bufferSize/2, g_lodPoints );
     // map the view port to the client area
     glViewport( 0, 0, w, h );
     // set the matrix mode to project
@@ -490,10 +1238,40 @@ void keyboardFunc( unsigned char key, int x, int y )
         case 'h':
             help();
             break;
+        case 'I':
+        case 'i':
+            inst_dump( &g_instrument, cerr );
+            break;
         case 'B':
         case 'b':
             g_noBug = !g_noBug;
             break;
+        case 'V':
+        case 'v':
+            g_binColor = !g_binColor;
+            break;
+        case 'O':
+        case 'o':
+            g_spectrogram = !g_spectrogram;
+            break;
+        case 'L':
+        case 'l':
+            g_showBands = !g_showBands;
+            break;
+        case 'T':
+        case 't':
+            g_beatSync = !g_beatSync;
+            break;
+        case 'N':
+        case 'n':
+            g_pitchColor = !g_pitchColor;
+            break;
+        case 'G':
+        case 'g':
+            g_gpuDraw = !g_gpuDraw;
+            cerr << "[sound-sphere]: drawing rings on the "
+                 << ( g_gpuDraw && colormap_ready() ? "GPU" : "CPU" ) << endl;
+            break;
         case 'M':
         case 'm': // toggle fullscreen
         {
@@ -581,12 +1359,68 @@ void mouseFunc( int button, int state, int x, int y )
 //-----------------------------------------------------------------------------
 void idleFunc( )
 {
+    // stats requested by signal
+    if( g_dumpStats )
+    {
+        g_dumpStats = 0;
+        inst_dump( &g_instrument, cerr );
+    }
+    
+    // replay finished: report and quit
+    if( g_replayDone.load( std::memory_order_acquire ) )
+    {
+        inst_dump( &g_instrument, cerr );
+        exit( 0 );
+    }
+    
+    // periodic metrics export
+    if( g_metrics )
+    {
+        uint64_t now = inst_now();
+        if( now - g_metricsLast >= METRICS_PERIOD )
+        {
+            g_metricsLast = now;
+            metrics_publish( g_metrics, &g_instrument, &g_frameTime,
+                             analysis_pending( g_analysis ), g_queueMax );
+        }
+    }
+    
     // render the scene
     glutPostRedisplay( );
 }
 
 
 
+//-----------------------------------------------------------------------------
+// Name: channelColor( )
+// Desc: ring color for a channel; each channel is offset around the cycle
+//-----------------------------------------------------------------------------
+void channelColor( int ch, const AnalysisFrame * frame, GLfloat c, GLfloat avg_max )
+{
+    if (g_party) {
+        Color color = {};
+        const PitchEstimate & pitch = frame->pitch[ch];
+        if (g_avMax) {
+            color = colorSpectrum((double)(avg_max*100.0));
+        } else if (g_pitchColor && pitch.f0 > 0 && pitch.confidence >= PITCH_CONFIDENT) {
+            // pitch class: C is violet, going round the spectrum to B
+            double octave = log2(pitch.f0 / 16.3516);
+            color = colorSpectrum(octave - floor(octave));
+        } else if (g_beatSync) { // flash on onsets, fade in between
+            color = colorSpectrum((double)frame->beat.pulse);
+        } else { // Use only the current max value
+            color = colorSpectrum((double)(frame->descriptors[ch].peak*100.0));
+        }
+        glColor3f(color.R, color.G, color.B);
+    } else {
+        c += .5 * ch;
+        glColor3f( (sin(c)+1)/2, (sin(c*2)+1)/2, (sin(c+.5)+1)/2 );
+    }
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // Name: displayFunc( )
 // Desc: callback function invoked to draw the client area
@@ -595,8 +1429,10 @@ void displayFunc( )
 {
     // local state
     static GLfloat zrot = 0.0f, c = 0.0f, xrot = 0.0f, breathe = 0.0f, breathe_angle = 0.0f, circ_rot = 0.0f, avg_max = 0.0f;
-    complex * cbuff = new complex[g_bufferSize/2];
-    SAMPLE * avg_buff;
+    long bins = g_bufferSize/2;
+    // rings show bands when there are any and 'l' hasn't turned them off
+    bool showBands = g_analysis->bandCount && g_showBands;
+    long ring = showBands ? (long)g_analysis->bandCount : bins;
     
     
     // enforce refresh rate
@@ -614,6 +1450,7 @@ void displayFunc( )
     }
     gettimeofday(&timer, NULL);
     time_pre = (long)(timer.tv_sec*1000000+timer.tv_usec);
+    uint64_t frameStart = inst_now();
     
     // clear the color and depth buffers
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
@@ -642,42 +1479,49 @@ void displayFunc( )
     
     if (g_window_on) drawWindow();
 
+    // newest spectra; not fresh if the analysis has nothing new for us
+    bool fresh = false;
+    const AnalysisFrame * frame = analysis_latest( g_analysis, &fresh );
+    // --smooth-rings filters bands if there are any, else bins
+    const complex * smoothed = frame->smoothed[ANALYSIS_VIEW_RINGS];
+    bool smoothRings = smoothed && showBands == ( g_analysis->bandCount > 0 );
+    // keep track of how far the analysis is behind
+    uint64_t pending = analysis_pending( g_analysis );
+    if( pending > g_queueMax ) g_queueMax = pending;
+
     // go
     glBegin( GL_LINE_STRIP );
-    // loop through global buffer
+    // loop through the first channel
     for( int i = 0; i < g_bufferSize; i++ )
     {
         // set the next vertex
-        glVertex2f( x, 5*g_buffer[i] );
+        glVertex2f( x, 5*frame->wave[i] );
         // increment x
         x += xinc;
     }
     // done
     glEnd();
+    g_vertexCount += g_bufferSize;
     
     
-    if (g_party) {
-        Color color = {};
-        // Average the max values over the history of max values
-        if (g_avMax) {
-            for (int i = 0; i < g_histSize; i++) {
-                avg_max += g_avg_buff[i];
-            }
-            avg_max = avg_max / g_histSize;
-            color = colorSpectrum((double)(avg_max*100.0));
-        } else { // Use only the current max value
-            color = colorSpectrum((double)(g_maxVal*100.0));
+    // Average the max values over the history of max values
+    if (g_party && g_avMax) {
+        for (int i = 0; i < g_histSize; i++) {
+            avg_max += g_analysis->historyMax[i];
         }
+        avg_max = avg_max / g_histSize;
+    }
     
-        glColor3f(color.R, color.G, color.B);
+    // pulse with the beat once there is a tempo, breathe otherwise
+    if (g_beatSync && frame->beat.bpm > 0) {
+        float fall = 1 - frame->beat.phase;
+        g_radius = .5 + fall*fall*fall;
     } else {
-        glColor3f( (sin(c)+1)/2, (sin(c*2)+1)/2, (sin(c+.5)+1)/2 );
+        // Set up breathing circle
+        breathe_angle = 2 * M_PI * breathe / (g_bufferSize/2);
+        g_radius = .5*sin(breathe_angle)+1;
     }
     
-    // Set up breathing circle
-    breathe_angle = 2 * M_PI * breathe / (g_bufferSize/2);
-    g_radius = .5*sin(breathe_angle)+1;
-    
     
     // rotation
     if (g_rotate) {
@@ -689,34 +1533,63 @@ void displayFunc( )
         circ_rot = 0.0f;
     }
     
-    memcpy( cbuff, g_cbuff, sizeof(complex)*(g_bufferSize/2));
-    
-    if (g_sphere && g_circle) {
+    if (g_spectrogram) {
+        // one row upload per new hop, one quad to draw
+        if (!g_spectrogramTex || g_spectrogramTex->bins != bins ||
+            g_spectrogramTex->channels != (unsigned int)g_channels) {
+            spectrogram_destroy( g_spectrogramTex );
+            g_spectrogramTex = spectrogram_create( bins, g_channels, SPECTROGRAM_ROWS );
+        }
+        spectrogram_update( g_spectrogramTex, g_analysis );
+        spectrogram_draw( g_spectrogramTex, -5, -3.5, 5, 3.5, -0.5 );
+        g_vertexCount += 4;
+    } else if (g_sphere && g_circle) {
         if (g_waterfall) {
-            for (int spectrum = 0; spectrum < g_maxCount; spectrum++){
+            int filled = g_analysis->histFilled.load( std::memory_order_acquire );
+            for (int spectrum = 0; spectrum < filled; spectrum++){
                 
                 glRotatef( circ_rot, 1, 0, 0 );
                 circ_rot += 0.0123;
-                drawCircle(g_cbuff_buff[spectrum]);
+                for (int ch = 0; ch < g_channels; ch++) {
+                    channelColor( ch, frame, c, avg_max );
+                    drawCircle( prepareRing( ch, smoothRings ? analysis_smooth_history( g_analysis, ANALYSIS_VIEW_RINGS, spectrum, ch )
+                                             : showBands ? analysis_band_history( g_analysis, spectrum, ch )
+                                             : analysis_history( g_analysis, spectrum, ch ), ring ),
+                                ch * g_channelSpacing );
+                }
             }
         } else {
+            // buggy mode only shows a spectrum the frame it arrives
+            const complex * current = smoothRings ? smoothed : showBands ? frame->bands : frame->spectrum;
+            const complex * spectra = ( g_noBug || fresh ) ? current : g_silence;
+            // the same rings 128 times: reduce and color each once
+            for (int ch = 0; ch < g_channels; ch++)
+                prepareRing( ch, spectra + ch * ring, ring );
             for (int i = 0; i < 128; i++) {
                 glRotatef( circ_rot, 1, 0, 0 );
                 circ_rot += 0.049; // 2*pi/128
-                if(g_noBug) {
-                    drawCircle(cbuff);
-                } else {
-                    drawCircle(g_cbuff);
+                for (int ch = 0; ch < g_channels; ch++) {
+                    channelColor( ch, frame, c, avg_max );
+                    drawCircle( g_rings[ch], ch * g_channelSpacing );
                 }
             }
-            for (int i = 0; i < (g_bufferSize/2); i++) {
-                g_cbuff[i].re = 0.0f;
-                g_cbuff[i].im = 0.0f;
-            }
         }
     } else if (g_circle) {
         glRotatef( circ_rot, 1, 0, 0 );
-        drawCircle(cbuff);
+        for (int ch = 0; ch < g_channels; ch++) {
+            channelColor( ch, frame, c, avg_max );
+            const complex * current = smoothRings ? smoothed : showBands ? frame->bands : frame->spectrum;
+            drawCircle( prepareRing( ch, current + ch * ring, ring ), ch * g_channelSpacing );
+        }
+        // the sliding dft, current to the last sample queued
+        if (g_sdft) {
+            const complex * sdft = sdft_latest( g_sdft, NULL );
+            for (int ch = 0; ch < g_channels; ch++) {
+                channelColor( ch, frame, c, avg_max );
+                drawCircle( prepareRing( g_channels + ch, sdft + ch * g_sdft->bins, g_sdft->bins ),
+                            ( g_channels + ch ) * g_channelSpacing );
+            }
+        }
     }
     
     // pop
@@ -732,4 +1605,6 @@ void displayFunc( )
     glFlush( );
     // swap the double buffer
     glutSwapBuffers( );
+    
+    hist_record( &g_frameTime, inst_now() - frameStart );
 }
@@ -0,0 +1,153 @@
+//-----------------------------------------------------------------------------
+// name: spectrogram.cpp
+// desc: scrolling spectrogram backed by a ring-buffer texture
+//-----------------------------------------------------------------------------
+#include "spectrogram.h"
+#include "color.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef __MACOSX_CORE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spectrogram_pow2()
+// desc: the smallest power of two >= n
+//-----------------------------------------------------------------------------
+static unsigned int spectrogram_pow2( unsigned int n )
+{
+    unsigned int p = 1;
+    while( p < n ) p <<= 1;
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+// name: spectrogram_create()
+// desc: allocate the texture, black, decimating each channel's bins to
+//       fit GL_MAX_TEXTURE_SIZE, with power-of-two sides
+//-----------------------------------------------------------------------------
+Spectrogram * spectrogram_create( unsigned int bins, unsigned int channels, unsigned int rows )
+{
+    GLint maxSize = 0;
+    glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxSize );
+    // GL guarantees at least 64; rounded down to a power of two so padded
+    // sides stay within it
+    if( maxSize < 64 ) maxSize = 64;
+    maxSize = spectrogram_pow2( maxSize / 2 + 1 );
+    rows = spectrogram_pow2( rows );
+    if( rows > (unsigned int)maxSize ) rows = maxSize;
+
+    Spectrogram * sg = new Spectrogram;
+    sg->bins = bins;
+    sg->channels = channels;
+    sg->columns = bins;
+    if( sg->columns * channels > (unsigned int)maxSize )
+        sg->columns = maxSize / channels > 0 ? maxSize / channels : 1;
+    sg->lod.start = NULL;
+    sg->lod.out = NULL;
+    lod_plan( &sg->lod, bins, sg->columns );
+    sg->width = sg->columns * channels;
+    sg->texWidth = spectrogram_pow2( sg->width );
+    sg->rows = rows;
+    sg->head = rows - 1;
+    sg->next = 0;
+    sg->level = new float[sg->width];
+    // rows of width, but big enough to clear the whole texture
+    sg->rgba = new unsigned char[4 * sg->texWidth * rows];
+    memset( sg->rgba, 0, 4 * sg->texWidth * rows );
+
+    GLuint texture = 0;
+    glGenTextures( 1, &texture );
+    glBindTexture( GL_TEXTURE_2D, texture );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    // rows wrap around: the quad starts at the oldest one
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, sg->texWidth, rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, sg->rgba );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+    sg->texture = texture;
+
+    return sg;
+}
+
+//-----------------------------------------------------------------------------
+// name: spectrogram_destroy()
+// desc: free the texture and buffers
+//-----------------------------------------------------------------------------
+void spectrogram_destroy( Spectrogram * sg )
+{
+    if( !sg ) return;
+    GLuint texture = sg->texture;
+    glDeleteTextures( 1, &texture );
+    lod_free( &sg->lod );
+    delete [] sg->level;
+    delete [] sg->rgba;
+    delete sg;
+}
+
+//-----------------------------------------------------------------------------
+// name: spectrogram_update()
+// desc: one glTexSubImage2D row per new hop, read from the analysis history
+//-----------------------------------------------------------------------------
+void spectrogram_update( Spectrogram * sg, Analysis * a )
+{
+    uint64_t produced = a->produced.load( std::memory_order_acquire );
+    // the history slot after the newest one may be being overwritten
+    uint64_t keep = a->histSize - 1 < sg->rows ? a->histSize - 1 : sg->rows;
+    if( produced - sg->next > keep ) sg->next = produced - keep;
+    if( sg->next >= produced ) return;
+
+    glBindTexture( GL_TEXTURE_2D, sg->texture );
+    for( ; sg->next < produced; sg->next++ )
+    {
+        unsigned int slot = (unsigned int)( sg->next % a->histSize );
+        for( unsigned int c = 0; c < sg->channels; c++ )
+        {
+            // same level as the ring colormap: sqrt(|X|), smoothed if
+            // --smooth-spectrogram is set
+            const complex * spectrum = analysis_smooth_history( a, ANALYSIS_VIEW_SPECTROGRAM, slot, c );
+            if( !spectrum ) spectrum = analysis_history( a, slot, c );
+            spectrum = lod_apply( &sg->lod, spectrum );
+            float * level = sg->level + c * sg->columns;
+            for( unsigned int k = 0; k < sg->columns; k++ )
+                level[k] = sqrtf( cmp_abs( spectrum[k] ) );
+        }
+        sg->head = (unsigned int)( sg->next % sg->rows );
+        unsigned char * row = sg->rgba + 4 * sg->width * sg->head;
+        colorSpectrumBatch8( sg->level, row, sg->width );
+        glTexSubImage2D( GL_TEXTURE_2D, 0, 0, sg->head, sg->width, 1, GL_RGBA, GL_UNSIGNED_BYTE, row );
+    }
+    glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+//-----------------------------------------------------------------------------
+// name: spectrogram_draw()
+// desc: texel centers of the oldest row at the bottom, newest at the top
+//-----------------------------------------------------------------------------
+void spectrogram_draw( const Spectrogram * sg, float x0, float y0, float x1, float y1, float z )
+{
+    float t0 = ( sg->head + 1.5f ) / sg->rows;
+    float t1 = t0 + ( sg->rows - 1.0f ) / sg->rows;
+    // only the used columns, stopping at the last one's center so the
+    // black padding never blends in
+    float s1 = sg->width == sg->texWidth ? 1.0f : ( sg->width - 0.5f ) / sg->texWidth;
+
+    glEnable( GL_TEXTURE_2D );
+    glBindTexture( GL_TEXTURE_2D, sg->texture );
+    glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE );
+    glBegin( GL_QUADS );
+    glTexCoord2f( 0, t0 ); glVertex3f( x0, y0, z );
+    glTexCoord2f( s1, t0 ); glVertex3f( x1, y0, z );
+    glTexCoord2f( s1, t1 ); glVertex3f( x1, y1, z );
+    glTexCoord2f( 0, t1 ); glVertex3f( x0, y1, z );
+    glEnd();
+    glBindTexture( GL_TEXTURE_2D, 0 );
+    glDisable( GL_TEXTURE_2D );
+}
@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// name: spectrogram.h
+// desc: scrolling spectrogram backed by a ring-buffer texture
+//
+//   every analysis hop becomes one texture row (all channels side by
+//   side, colored with colorSpectrum()), written over the oldest row with
+//   glTexSubImage2D.  the display is one textured quad whose texture
+//   coordinates start at the oldest row and wrap, so nothing ever moves
+//   in memory and each frame costs one row upload per new hop.  a row
+//   wider than GL_MAX_TEXTURE_SIZE is decimated with a lod plan first,
+//   and the texture is padded to power-of-two sides for OpenGL 1.x.
+//-----------------------------------------------------------------------------
+#ifndef __SPECTROGRAM_H__
+#define __SPECTROGRAM_H__
+
+#include "analysis.h"
+#include "lod.h"
+#include <stdint.h>
+
+
+//-----------------------------------------------------------------------------
+// name: struct Spectrogram
+// desc: texture and upload state
+//-----------------------------------------------------------------------------
+struct Spectrogram
+{
+    unsigned int texture;
+    unsigned int bins;
+    unsigned int channels;
+    // texels per channel (bins, or fewer to fit the texture size limit)
+    // and the plan reducing bins to them
+    unsigned int columns;
+    Lod lod;
+    // texels used per row (columns * channels), the texture's width (that
+    // rounded up to a power of two; the rest stays black and is never
+    // drawn) and rows (a power of two)
+    unsigned int width;
+    unsigned int texWidth;
+    unsigned int rows;
+    // row holding the newest hop, and the next hop number to upload
+    unsigned int head;
+    uint64_t next;
+    // one row: levels, then RGBA8
+    float * level;
+    unsigned char * rgba;
+};
+
+
+// texture for `rows` hops of bins x channels, both within the GL's texture
+// size limit (needs a current context)
+Spectrogram * spectrogram_create( unsigned int bins, unsigned int channels, unsigned int rows );
+void spectrogram_destroy( Spectrogram * sg );
+// upload the hops published since the last call (at most the history)
+void spectrogram_update( Spectrogram * sg, Analysis * a );
+// one quad from (x0, y0) to (x1, y1) at depth z, newest hop at the top
+void spectrogram_draw( const Spectrogram * sg, float x0, float y0, float x1, float y1, float z );
+
+
+#endif